@@ -0,0 +1,92 @@
+/** \file BucketWheel.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class BucketWheel
+#include "BucketWheel.h"
+
+using namespace std;
+
+BucketWheel::BucketWheel(void)
+:	buckets(1),
+	count(0)
+{
+}
+
+void BucketWheel::reset(unsigned int horizon)
+{
+	buckets.assign((size_t)horizon + 1, vector<DotId>());
+	count = 0;
+}
+
+void BucketWheel::add(unsigned int frame, DotId id)
+{
+	buckets[frame % buckets.size()].push_back(id);
+	count++;
+}
+
+void BucketWheel::take(unsigned int frame, vector<DotId>& ids)
+{
+	// the caller's vector goes back in the bucket, keeping its capacity
+	vector<DotId>& bucket = buckets[frame % buckets.size()];
+	ids.clear();
+	ids.swap(bucket);
+	count -= ids.size();
+}
+
+unsigned int BucketWheel::size(void) const
+{
+	return count;
+}
+
+size_t BucketWheel::getMemoryUsage(void) const
+{
+	size_t bytes = buckets.capacity() * sizeof(vector<DotId>);
+	for (const vector<DotId>& bucket : buckets)
+		bytes += bucket.capacity() * sizeof(DotId);
+	return bytes;
+}
+
+void BucketWheel::save(Checkpoint::Writer& out) const
+{
+	out.value((unsigned int)buckets.size());
+	for (const vector<DotId>& bucket : buckets)
+		out.array(bucket);
+}
+
+bool BucketWheel::restore(Checkpoint::Reader& in)
+{
+	unsigned int n = 0;
+	in.value(n);
+	bool ok = in.good() && n == buckets.size();
+	count = 0;
+	for (size_t k = 0 ; ok && k < buckets.size() ; k++) {
+		ok = in.array(buckets[k]);
+		count += buckets[k].size();
+	}
+	if (!ok) {
+		in.fail();
+		reset(buckets.size() - 1);
+	}
+	return ok;
+}
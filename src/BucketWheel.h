@@ -0,0 +1,77 @@
+/** \file BucketWheel.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BucketWheel_H
+#define BucketWheel_H
+
+#include <vector>
+#include "Checkpoint.h"
+#include "Dot.h"
+
+/** Dot IDs filed by the frame they are due in (SCHEDULE_LIFETIMES),
+ * over a ring of one bucket per frame up to a fixed horizon. Adding and
+ * taking an ID are both constant time, so a step only spends on the
+ * dots due in it, however many are filed for later.
+ */
+class BucketWheel
+{
+private:
+	/** IDs by frame, modulo the number of buckets */
+	std::vector<std::vector<DotId>> buckets;
+	unsigned int count;
+
+public:
+	BucketWheel(void);
+
+	/** Empty the wheel.
+	 * \param horizon how many frames ahead IDs may be filed
+	 */
+	void reset(unsigned int horizon);
+
+	/** File an ID for a frame after the one last taken, and no further
+	 * ahead of it than the horizon. */
+	void add(unsigned int frame, DotId id);
+
+	/** Take the IDs filed for a frame, which must come right after the
+	 * one last taken.
+	 * \param ids set to the IDs, in the order they were filed
+	 */
+	void take(unsigned int frame, std::vector<DotId>& ids);
+
+	/** \return the number of IDs filed */
+	unsigned int size(void) const;
+
+	/** \return the bytes held by the wheel */
+	size_t getMemoryUsage(void) const;
+
+	/** Add the wheel to a checkpoint. */
+	void save(Checkpoint::Writer& out) const;
+	/** Take the wheel back from a checkpoint, into a wheel reset to the
+	 * same horizon.
+	 * \return false if it could not be read
+	 */
+	bool restore(Checkpoint::Reader& in);
+};
+
+#endif
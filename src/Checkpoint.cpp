@@ -0,0 +1,242 @@
+/** \file Checkpoint.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//namespace Checkpoint
+#include "Checkpoint.h"
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	const char MAGIC[8] = { 'D', 'O', 'T', 'S', 'C', 'K', 'P', 'T' };
+	constexpr size_t ALIGN = 8;
+	const char ZEROS[ALIGN] = { 0 };
+
+	/** What a checkpoint must agree on with the reading machine. */
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint8_t sizes[8];
+	};
+
+	Header thisMachine(void)
+	{
+		Header header;
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = Checkpoint::FORMAT_VERSION;
+		header.byte_order = 0x01020304;
+		const uint8_t sizes[8] = { sizeof(short), sizeof(int), sizeof(long), sizeof(long long),
+				sizeof(float), sizeof(double), sizeof(size_t), sizeof(bool) };
+		memcpy(header.sizes, sizes, sizeof(sizes));
+		return header;
+	}
+
+	size_t padding(size_t size)
+	{
+		return (ALIGN - size % ALIGN) % ALIGN;
+	}
+}
+
+Checkpoint::Writer::Writer(void)
+:	pieces(),
+	inline_data()
+{
+	value(thisMachine());
+}
+
+void Checkpoint::Writer::addInline(const void* data, size_t size)
+{
+	const size_t offset = inline_data.size();
+	const char* bytes = static_cast<const char*>(data);
+	inline_data.insert(inline_data.end(), bytes, bytes + size);
+	inline_data.insert(inline_data.end(), ZEROS, ZEROS + padding(size));
+
+	// consecutive values make a single piece
+	if (!pieces.empty() && pieces.back().data == nullptr
+			&& pieces.back().offset + pieces.back().size == offset)
+		pieces.back().size = inline_data.size() - pieces.back().offset;
+	else
+		pieces.push_back(Piece { nullptr, offset, inline_data.size() - offset });
+}
+
+void Checkpoint::Writer::addPadding(size_t size)
+{
+	if (padding(size) > 0)
+		pieces.push_back(Piece { ZEROS, 0, padding(size) });
+}
+
+bool Checkpoint::Writer::write(const string& filename, ostream& log) const
+{
+	vector<iovec> iov;
+	for (const Piece& piece : pieces) {
+		const char* base = piece.data ? static_cast<const char*>(piece.data)
+				: inline_data.data() + piece.offset;
+		iov.push_back(iovec { const_cast<char*>(base), piece.size });
+	}
+
+	const string temporary = filename + ".tmp";
+	const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		log << "Cannot create " << temporary << ": " << strerror(errno) << endl;
+		return false;
+	}
+
+	// one gathered write, only resumed when the system cuts it short
+	size_t first = 0;
+	bool ok = true;
+	const long iov_max = sysconf(_SC_IOV_MAX);
+	const size_t max_pieces = (iov_max > 0) ? iov_max : 16;
+	while (ok && first < iov.size()) {
+		const int count = (int)min(iov.size() - first, max_pieces);
+		ssize_t written = writev(fd, &iov[first], count);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			ok = false;
+			break;
+		}
+		while (first < iov.size() && (size_t)written >= iov[first].iov_len) {
+			written -= iov[first].iov_len;
+			first++;
+		}
+		if (written > 0) {
+			iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+			iov[first].iov_len -= written;
+		}
+	}
+	if (!ok)
+		log << "Cannot write " << temporary << ": " << strerror(errno) << endl;
+
+	if (::close(fd) != 0 && ok) {
+		log << "Cannot write " << temporary << ": " << strerror(errno) << endl;
+		ok = false;
+	}
+	if (ok && rename(temporary.c_str(), filename.c_str()) != 0) {
+		log << "Cannot rename " << temporary << " to " << filename << ": " << strerror(errno) << endl;
+		ok = false;
+	}
+	if (!ok)
+		unlink(temporary.c_str());
+	return ok;
+}
+
+Checkpoint::Reader::Reader(void)
+:	map(MAP_FAILED),
+	map_size(0),
+	data(nullptr),
+	size(0),
+	pos(0),
+	failed(true)
+{
+}
+
+Checkpoint::Reader::~Reader()
+{
+	if (map != MAP_FAILED)
+		munmap(map, map_size);
+}
+
+bool Checkpoint::Reader::open(const string& filename, ostream& log)
+{
+	const int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		log << "Cannot open " << filename << ": " << strerror(errno) << endl;
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(Header)) {
+		log << filename << " is not a checkpoint" << endl;
+		::close(fd);
+		return false;
+	}
+	map_size = info.st_size;
+#ifdef MAP_POPULATE
+	// every page is about to be read
+	map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+#else
+	map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+#endif
+	::close(fd);
+	if (map == MAP_FAILED) {
+		log << "Cannot map " << filename << ": " << strerror(errno) << endl;
+		return false;
+	}
+	data = static_cast<const char*>(map);
+	size = map_size;
+	pos = 0;
+	failed = false;
+
+	const Header expected = thisMachine();
+	Header header;
+	value(header);
+	if (memcmp(header.magic, expected.magic, sizeof(MAGIC)) != 0) {
+		log << filename << " is not a checkpoint" << endl;
+		failed = true;
+	} else if (header.version != expected.version) {
+		log << filename << " has format version " << header.version
+			<< ", not " << expected.version << endl;
+		failed = true;
+	} else if (header.byte_order != expected.byte_order
+			|| memcmp(header.sizes, expected.sizes, sizeof(header.sizes)) != 0) {
+		log << filename << " was written by a different kind of machine" << endl;
+		failed = true;
+	}
+	return !failed;
+}
+
+const char* Checkpoint::Reader::take(size_t n)
+{
+	const size_t padded = n + padding(n);
+	if (failed || padded > size - pos) {
+		failed = true;
+		return nullptr;
+	}
+	const char* p = data + pos;
+	pos += padded;
+	return p;
+}
+
+void Checkpoint::Reader::fail(void)
+{
+	failed = true;
+}
+
+bool Checkpoint::Reader::good(void) const
+{
+	return !failed;
+}
+
+bool Checkpoint::Reader::complete(void) const
+{
+	return !failed && pos == size;
+}
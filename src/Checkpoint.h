@@ -0,0 +1,160 @@
+/** \file Checkpoint.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef Checkpoint_H
+#define Checkpoint_H
+
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/** Binary snapshots of a simulation, see Simulator::save.
+ * A checkpoint starts with a header: a magic string, the format version,
+ * and the byte order and type sizes of the machine which wrote it, where
+ * it may only be read back. Sections follow, each one padded to 8 bytes:
+ * values as they lie in memory, and arrays as their length followed by
+ * their elements. Arrays are never copied to be written, the whole file
+ * going out in a single gathered write, and are copied straight into
+ * place from a memory mapping when read.
+ */
+namespace Checkpoint
+{
+	/** Version of the format, to be raised with any change to it. */
+	constexpr unsigned int FORMAT_VERSION = 6;
+
+	class Writer
+	{
+	private:
+		/** A piece of the file, in <tt>data</tt> or else in
+		 * <tt>inline_data</tt> at <tt>offset</tt> */
+		struct Piece
+		{
+			const void* data;
+			size_t offset;
+			size_t size;
+		};
+		std::vector<Piece> pieces;
+		/** Copies of the values, the arrays staying where they are */
+		std::vector<char> inline_data;
+
+		void addInline(const void* data, size_t size);
+		void addPadding(size_t size);
+
+	public:
+		Writer(void);
+
+		template<typename T>
+		void value(const T& v)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "values are copied bytewise");
+			addInline(&v, sizeof(T));
+		}
+
+		/** Add an array, which must stay untouched until written. */
+		template<typename T>
+		void array(const std::vector<T>& v)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "arrays are copied bytewise");
+			value((unsigned long long)v.size());
+			if (v.empty())
+				return;
+			pieces.push_back(Piece { v.data(), 0, v.size() * sizeof(T) });
+			addPadding(v.size() * sizeof(T));
+		}
+
+		/** Write the checkpoint to a new file, then rename it over
+		 * <tt>filename</tt>, which is never left half-written.
+		 * \param log where errors are reported
+		 */
+		bool write(const std::string& filename, std::ostream& log) const;
+	};
+
+	class Reader
+	{
+	private:
+		void* map;
+		size_t map_size;
+		const char* data;
+		size_t size;
+		size_t pos;
+		bool failed;
+
+		/** The next n bytes (padded to 8), or nullptr past the end */
+		const char* take(size_t n);
+
+	public:
+		Reader(void);
+		~Reader();
+
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+
+		/** Map a checkpoint and check its header.
+		 * \param log where errors are reported
+		 */
+		bool open(const std::string& filename, std::ostream& log);
+
+		template<typename T>
+		bool value(T& v)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "values are copied bytewise");
+			const char* p = take(sizeof(T));
+			if (p)
+				std::memcpy(&v, p, sizeof(T));
+			return p != nullptr;
+		}
+
+		template<typename T>
+		bool array(std::vector<T>& v)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "arrays are copied bytewise");
+			unsigned long long n;
+			if (!value(n) || n > (size - pos) / sizeof(T)) {
+				failed = true;
+				return false;
+			}
+			// the padding may still run past the end
+			const T* first = reinterpret_cast<const T*>(take(n * sizeof(T)));
+			if (!first) {
+				failed = true;
+				return false;
+			}
+			v.assign(first, first + n);
+			return true;
+		}
+
+		/** Mark the checkpoint as invalid, for a value out of range. */
+		void fail(void);
+		/** \return whether every read so far succeeded */
+		bool good(void) const;
+
+		/** \return whether every read so far succeeded, and the whole
+		 * checkpoint was read */
+		bool complete(void) const;
+	};
+}
+
+#endif
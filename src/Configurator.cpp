@@ -25,27 +25,110 @@
  */
 //namespace Configurator
 #include "Configurator.h"
+#include <cmath>
 
 using namespace std;
 
-bool Configurator::configure(std::unique_ptr<Simulator> & simulator)
+namespace
+{
+	const char* const DENSITY_MODE_NAMES[] = { "direct", "fft", "incremental", "tree" };
+	const char* const STEP_MODE_NAMES[] = { "serial", "parallel" };
+	const char* const RNG_MODE_NAMES[] = { "global", "counter" };
+	const char* const SCHEDULE_MODE_NAMES[] = { "steps", "events", "lifetimes" };
+
+	/** Parse the whole text as a value. */
+	template<typename T>
+	bool parse(const string& text, T& value)
+	{
+		istringstream input(text);
+		input >> value;
+		return !input.fail() && (input >> ws).eof();
+	}
+
+	/** Parse a mode name into an enumeration, names being in value order. */
+	template<typename E, size_t N>
+	bool parseName(const string& text, E& value, const char* const (&names)[N])
+	{
+		for (size_t i = 0 ; i < N ; i++) {
+			if (text == names[i]) {
+				value = static_cast<E>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** \return whether a grid size is at least 1, and fits the dot store */
+	bool validGridSize(int size)
+	{
+		return size >= 1 && size <= DotStore::MAX_GRID;
+	}
+
+	/** \return whether an eating or generation time lasts at least a frame,
+	 * and fits the dot store's counters */
+	bool validTime(int time)
+	{
+		return time >= 1 && time <= DotStore::MAX_COUNT;
+	}
+
+	/** \return whether a density tree opening angle is finite and not
+	 * negative, 0 walking the whole tree for exact sums */
+	bool validTheta(double theta)
+	{
+		return theta >= 0 && isfinite(theta);
+	}
+
+	/** Check the values the dot store has to hold in its narrow columns,
+	 * the ages the transition table has to cover, and that no size, count
+	 * or time is out of its range. */
+	bool fitsStore(const Configurator::Settings& settings, ostream& log)
+	{
+		if (!validGridSize(settings.grid_w) || !validGridSize(settings.grid_h)) {
+			log << "The grid must be from 1 to " << DotStore::MAX_GRID
+					<< " positions wide and high" << endl;
+			return false;
+		}
+		if (settings.init_dots < 0) {
+			log << "init_dots may not be negative" << endl;
+			return false;
+		}
+		if (!validTime(settings.dotconf.eat_time)
+				|| !validTime(settings.dotconf.generation_time)) {
+			log << "eat_time and generation_time must be from 1 to "
+					<< DotStore::MAX_COUNT << endl;
+			return false;
+		}
+		if (!(settings.dotconf.death_chance_maj >= 0
+				&& settings.dotconf.death_chance_maj < TransitionTable::MAX_AGES)) {
+			log << "death_chance_maj must be at least 0 and below "
+					<< TransitionTable::MAX_AGES << endl;
+			return false;
+		}
+		return true;
+	}
+}
+
+Configurator::Settings::Settings()
+:	rand_seed(0),
+	grid_w(0),
+	grid_h(0),
+	init_dots(0),
+	dotconf()
+{
+}
+
+bool Configurator::read(const string& filename, Settings& settings, ostream& log)
 {
-	//Simulator config variables
-	int rand_seed, grid_w = 0, grid_h = 0, init_dots = 0;
-
-	//DotConf create
-	DotConf dotconf;
-
 	int varnum = 0;
 	ifstream input;
 
-	cout << "Attempting to read " << CONFIG_FILENAME << "..." << endl;
+	log << "Attempting to read " << filename << "..." << endl;
 
-	input.open(CONFIG_FILENAME);
+	input.open(filename.c_str());
 
 	if (!input)
 	{
-		cout << "Fail #1" << endl;
+		log << "Fail #1" << endl;
 		return false;
 	}
 
@@ -54,52 +137,52 @@ bool Configurator::configure(std::unique_ptr<Simulator> & simulator)
 		switch (varnum)
 		{
 		case 0:  //rand_seed
-			input >> rand_seed;
-			cout << "rand_seed: " << rand_seed << endl;
+			input >> settings.rand_seed;
+			log << "rand_seed: " << settings.rand_seed << endl;
 			break;
 		case 1: //grid_width
-			input >> grid_w;
-			cout << "grid_w: " << grid_w << endl;
+			input >> settings.grid_w;
+			log << "grid_w: " << settings.grid_w << endl;
 			break;
 		case 2:  //grid_height
-			input >> grid_h;
-			cout << "grid_h: " << grid_h << endl;
+			input >> settings.grid_h;
+			log << "grid_h: " << settings.grid_h << endl;
 			break;
 		case 3:  //init_dots
-			input >> init_dots;
-			cout << "init_dots: " << init_dots << endl;
+			input >> settings.init_dots;
+			log << "init_dots: " << settings.init_dots << endl;
 			break;
 		case 4:  //hunger_chance
-			input >> dotconf.hunger_chance;
-			cout << "hunger_chance: " << dotconf.hunger_chance << endl;
+			input >> settings.dotconf.hunger_chance;
+			log << "hunger_chance: " << settings.dotconf.hunger_chance << endl;
 			break;
 		case 5:  //eating_chance_p
-			input >> dotconf.dot_density;
-			cout << "dot_density: " << dotconf.dot_density << endl;
+			input >> settings.dotconf.dot_density;
+			log << "dot_density: " << settings.dotconf.dot_density << endl;
 			break;
 		case 6:  //death_chance_maj
-			input >> dotconf.death_chance_maj;
-			cout << "death_chance_maj: " << dotconf.death_chance_maj << endl;
+			input >> settings.dotconf.death_chance_maj;
+			log << "death_chance_maj: " << settings.dotconf.death_chance_maj << endl;
 			break;
 		case 7:  //looking_chance_mean
-			input >> dotconf.looking_chance_mean;
-			cout << "looking_chance_mean: " << dotconf.looking_chance_mean << endl;
+			input >> settings.dotconf.looking_chance_mean;
+			log << "looking_chance_mean: " << settings.dotconf.looking_chance_mean << endl;
 			break;
 		case 8:  //looking_chance_var
-			input >> dotconf.looking_chance_var;
-			cout << "looking_chance_var: " << dotconf.looking_chance_var << endl;
+			input >> settings.dotconf.looking_chance_var;
+			log << "looking_chance_var: " << settings.dotconf.looking_chance_var << endl;
 			break;
 		case 9:  //looking_chance_p
-			input >> dotconf.looking_chance_p;
-			cout << "looking_chance_p: " << dotconf.looking_chance_p << endl;
+			input >> settings.dotconf.looking_chance_p;
+			log << "looking_chance_p: " << settings.dotconf.looking_chance_p << endl;
 			break;
 		case 10: //eat_time
-			input >> dotconf.eat_time;
-			cout << "eat_time: " << dotconf.eat_time << endl;
+			input >> settings.dotconf.eat_time;
+			log << "eat_time: " << settings.dotconf.eat_time << endl;
 			break;
 		case 11: //generation_time
-			input >> dotconf.generation_time;
-			cout << "generation_time: " << dotconf.generation_time << endl;
+			input >> settings.dotconf.generation_time;
+			log << "generation_time: " << settings.dotconf.generation_time << endl;
 			break;
 		}
 		varnum++;
@@ -117,13 +200,88 @@ bool Configurator::configure(std::unique_ptr<Simulator> & simulator)
 			while(input.get() != '\n');
 	}
 
-	dotconf.updateLookProb();
-
-	simulator.reset(new Simulator(rand_seed, dotconf, grid_w, grid_h));
-
-	for (int i = 0 ; i < init_dots ; i++) {
-		simulator->addRDot();
-	}
-
-	return (varnum == 12);
+	return (varnum == 12) && fitsStore(settings, log);
 }
+
+bool Configurator::assign(Settings& settings, const string& assignment)
+{
+	const size_t eq = assignment.find('=');
+	if (eq == string::npos)
+		return false;
+	const string name = assignment.substr(0, eq);
+	const string value = assignment.substr(eq + 1);
+	DotConf& dotconf = settings.dotconf;
+
+	if (name == "rand_seed")
+		return parse(value, settings.rand_seed);
+	if (name == "grid_w")
+		return parse(value, settings.grid_w) && validGridSize(settings.grid_w);
+	if (name == "grid_h")
+		return parse(value, settings.grid_h) && validGridSize(settings.grid_h);
+	if (name == "init_dots")
+		return parse(value, settings.init_dots) && settings.init_dots >= 0;
+	if (name == "hunger_chance")
+		return parse(value, dotconf.hunger_chance);
+	if (name == "dot_density")
+		return parse(value, dotconf.dot_density);
+	if (name == "death_chance_maj")
+		return parse(value, dotconf.death_chance_maj) && dotconf.death_chance_maj >= 0
+				&& dotconf.death_chance_maj < TransitionTable::MAX_AGES;
+	if (name == "looking_chance_mean")
+		return parse(value, dotconf.looking_chance_mean);
+	if (name == "looking_chance_var")
+		return parse(value, dotconf.looking_chance_var);
+	if (name == "looking_chance_p")
+		return parse(value, dotconf.looking_chance_p);
+	if (name == "eat_time")
+		return parse(value, dotconf.eat_time) && validTime(dotconf.eat_time);
+	if (name == "generation_time")
+		return parse(value, dotconf.generation_time) && validTime(dotconf.generation_time);
+
+	if (name == "density_mode")
+		return parseName(value, dotconf.density_mode, DENSITY_MODE_NAMES);
+	if (name == "density_rebuild_period")
+		return parse(value, dotconf.density_rebuild_period);
+	if (name == "density_theta")
+		return parse(value, dotconf.density_theta) && validTheta(dotconf.density_theta);
+	if (name == "density_single")
+		return parse(value, dotconf.density_single);
+	if (name == "step_mode")
+		return parseName(value, dotconf.step_mode, STEP_MODE_NAMES);
+	if (name == "step_threads")
+		return parse(value, dotconf.step_threads) && dotconf.step_threads <= ThreadPool::MAX_THREADS;
+	if (name == "rng_mode")
+		return parseName(value, dotconf.rng_mode, RNG_MODE_NAMES);
+	if (name == "schedule_mode")
+		return parseName(value, dotconf.schedule_mode, SCHEDULE_MODE_NAMES);
+	if (name == "nearest_check")
+		return parse(value, dotconf.nearest_check);
+	if (name == "profile")
+		return parse(value, dotconf.profile);
+	if (name == "profile_period")
+		return parse(value, dotconf.profile_period);
+
+	return false;
+}
+
+void Configurator::create(const Settings& settings, std::unique_ptr<Simulator> & simulator)
+{
+	DotConf dotconf(settings.dotconf);
+	dotconf.updateLookProb();
+
+	simulator.reset(new Simulator(settings.rand_seed, dotconf, settings.grid_w, settings.grid_h));
+
+	for (int i = 0 ; i < settings.init_dots ; i++) {
+		simulator->addRDot();
+	}
+}
+
+bool Configurator::configure(std::unique_ptr<Simulator> & simulator)
+{
+	Settings settings;
+	if (!read(CONFIG_FILENAME, settings, cout))
+		return false;
+
+	create(settings, simulator);
+	return true;
+}
@@ -27,6 +27,7 @@
 #include <sstream>
 #include <stdlib.h>
 #include <memory>
+#include <string>
 #include "Simulator.h"
 #include "DotConf.h"
 
@@ -34,5 +35,40 @@
 
 namespace Configurator
 {
+	/** Everything needed to start a simulation. */
+	struct Settings
+	{
+		Settings();
+
+		int rand_seed;
+		int grid_w;
+		int grid_h;
+		int init_dots;
+		DotConf dotconf;
+	};
+
+	/** Read settings from a config file, in config.txt format.
+	 * \param log where every value read is echoed
+	 * \return whether all 12 values could be read, and fit the dot store
+	 * (see DotStore::MAX_GRID and DotStore::MAX_COUNT)
+	 */
+	bool read(const std::string& filename, Settings& settings, std::ostream& log);
+
+	/** Override one setting, given as <tt>name=value</tt>.
+	 * Names are those of the config.txt values (rand_seed, grid_w, ...,
+	 * generation_time) and of the engine options, which take a mode name:
+	 * density_mode (direct, fft, incremental, tree), density_rebuild_period,
+	 * density_theta, density_single, step_mode (serial, parallel),
+	 * step_threads, rng_mode (global, counter), schedule_mode (steps,
+	 * events, lifetimes), nearest_check, profile and profile_period.
+	 * \return false for an unknown name, a malformed value, or one out of
+	 * its range or that the dot store cannot hold
+	 */
+	bool assign(Settings& settings, const std::string& assignment);
+
+	/** Create a simulator from the settings, with init_dots random dots. */
+	void create(const Settings& settings, std::unique_ptr<Simulator> & p_simulator);
+
+	/** Create a simulator from CONFIG_FILENAME. */
 	bool configure(std::unique_ptr<Simulator> & p_simulator);
 }
@@ -0,0 +1,276 @@
+/** \file DensityField.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class DensityField
+#include "DensityField.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+DensityField::DensityField(void)
+:	grid_w(0),
+	grid_h(0),
+	kernel(),
+	kernel_hat(),
+	p_fft_w(),
+	p_fft_h(),
+	work(),
+	column(),
+	field(),
+	counts(),
+	delta(),
+	touched()
+{
+}
+
+void DensityField::reset(int w, int h)
+{
+	this->grid_w = w;
+	this->grid_h = h;
+	const size_t ncells = (size_t)w * h;
+
+	p_fft_w.reset(new FFT(w));
+	p_fft_h.reset(new FFT(h));
+	work.resize(ncells);
+	column.resize(h);
+	field.assign(ncells, 0);
+	counts.assign(ncells, 0);
+	delta.assign(ncells, 0);
+	touched.clear();
+
+	// same metric as Simulator::distSqr
+	kernel.resize(ncells);
+	for (int y = 0 ; y < h ; y++) {
+		int dy = (y > h/2) ? h - y : y;
+		for (int x = 0 ; x < w ; x++) {
+			int dx = (x > w/2) ? w - x : x;
+			const double d2 = (double)dx*dx + (double)dy*dy;
+			kernel[(size_t)y * w + x] = (d2 == 0) ? 0.0 : 1.0 / d2;
+		}
+	}
+
+	for (size_t i = 0 ; i < ncells ; i++)
+		work[i] = FFT::Complex(kernel[i], 0);
+	transform2D(false);
+
+	kernel_hat.resize(ncells);
+	for (size_t i = 0 ; i < ncells ; i++)
+		kernel_hat[i] = work[i].real();
+}
+
+void DensityField::transform2D(bool inverse)
+{
+	const int w = this->grid_w, h = this->grid_h;
+
+	for (int y = 0 ; y < h ; y++)
+		p_fft_w->transform(&work[(size_t)y * w], inverse);
+
+	for (int x = 0 ; x < w ; x++) {
+		for (int y = 0 ; y < h ; y++)
+			column[y] = work[(size_t)y * w + x];
+		p_fft_h->transform(column.data(), inverse);
+		for (int y = 0 ; y < h ; y++)
+			work[(size_t)y * w + x] = column[y];
+	}
+}
+
+void DensityField::convolveCounts(void)
+{
+	const size_t ncells = counts.size();
+
+	for (size_t i = 0 ; i < ncells ; i++)
+		work[i] = FFT::Complex(counts[i], 0);
+	transform2D(false);
+	for (size_t i = 0 ; i < ncells ; i++)
+		work[i] *= kernel_hat[i];
+	transform2D(true);
+}
+
+void DensityField::recompute(void)
+{
+	const size_t ncells = counts.size();
+
+	convolveCounts();
+	for (size_t i = 0 ; i < ncells ; i++)
+		field[i] = work[i].real() / ncells;
+}
+
+void DensityField::rebuild(const DotStore::Buffer& dots)
+{
+	for (size_t c : touched)
+		delta[c] = 0;
+	touched.clear();
+
+	fill(counts.begin(), counts.end(), 0);
+	for (unsigned int i = 0 ; i < dots.size() ; i++)
+		counts[(size_t)dots.y[i] * grid_w + dots.x[i]]++;
+
+	recompute();
+}
+
+void DensityField::queue(int x, int y, int n)
+{
+	const size_t c = (size_t)y * grid_w + x;
+	if (delta[c] == 0)
+		touched.push_back(c);
+	delta[c] += n;
+}
+
+void DensityField::add(int x, int y)
+{
+	queue(x, y, 1);
+}
+
+void DensityField::remove(int x, int y)
+{
+	queue(x, y, -1);
+}
+
+void DensityField::move(int ox, int oy, int nx, int ny)
+{
+	queue(ox, oy, -1);
+	queue(nx, ny, 1);
+}
+
+void DensityField::applyKernel(size_t c, int n)
+{
+	const int w = this->grid_w, h = this->grid_h;
+	const int cx = (int)(c % w), cy = (int)(c / w);
+
+	// field(x,y) += n * kernel(x - cx, y - cy), each row of the
+	// shifted kernel being two contiguous runs
+	for (int y = 0 ; y < h ; y++) {
+		const double* krow = &kernel[(size_t)((y - cy + h) % h) * w];
+		double* frow = &field[(size_t)y * w];
+		for (int x = 0 ; x < cx ; x++)
+			frow[x] += n * krow[x - cx + w];
+		for (int x = cx ; x < w ; x++)
+			frow[x] += n * krow[x - cx];
+	}
+}
+
+void DensityField::commit(bool full)
+{
+	// a cell moved back and forth leaves no change behind
+	size_t nchanged = 0;
+	for (size_t c : touched) {
+		if (delta[c] != 0)
+			nchanged++;
+	}
+
+	// each kernel copy costs about as much as one pass over the grid,
+	// a full convolution about as much as a few passes per FFT level
+	const double passes = 4 * log2((double)counts.size() + 1);
+	const bool rebuild_all = full || nchanged > passes;
+
+	for (size_t c : touched) {
+		if (delta[c] == 0)
+			continue;
+		counts[c] += delta[c];
+		if (!rebuild_all)
+			applyKernel(c, delta[c]);
+		delta[c] = 0;
+	}
+	touched.clear();
+
+	if (rebuild_all)
+		recompute();
+}
+
+double DensityField::measureDrift(void)
+{
+	const size_t ncells = counts.size();
+
+	convolveCounts();
+
+	// a cell with no dot around but its own is exactly 0, which round-off
+	// turns into noise; any other dot adds at least the farthest kernel value
+	const double half_w = grid_w / 2, half_h = grid_h / 2;
+	const double smallest = 0.5 / (half_w * half_w + half_h * half_h);
+
+	double drift = 0;
+	for (size_t i = 0 ; i < ncells ; i++) {
+		double exact = work[i].real() / ncells;
+		if (exact < smallest)
+			continue;
+		drift = max(drift, fabs(field[i] - exact) / exact);
+	}
+	return drift;
+}
+
+double DensityField::sumAt(int x, int y) const
+{
+	// round-off may leave tiny negatives where the field is empty
+	return max(0.0, field[(size_t)y * grid_w + x]);
+}
+
+unsigned int DensityField::countAt(int x, int y) const
+{
+	return counts[(size_t)y * grid_w + x];
+}
+
+void DensityField::save(Checkpoint::Writer& out) const
+{
+	// queued changes by touched cell, in the order they get applied
+	vector<int> touched_delta;
+	touched_delta.reserve(touched.size());
+	for (size_t c : touched)
+		touched_delta.push_back(delta[c]);
+
+	out.array(field);
+	out.array(counts);
+	out.array(touched);
+	out.value(touched_delta.size());
+	for (int n : touched_delta)
+		out.value(n);
+}
+
+bool DensityField::restore(Checkpoint::Reader& in)
+{
+	const size_t ncells = counts.size();
+	in.array(field);
+	in.array(counts);
+	in.array(touched);
+	size_t ntouched = 0;
+	in.value(ntouched);
+
+	bool ok = in.good() && field.size() == ncells && counts.size() == ncells
+			&& ntouched == touched.size();
+	fill(delta.begin(), delta.end(), 0);
+	for (size_t k = 0 ; ok && k < ntouched ; k++) {
+		int n = 0;
+		ok = in.value(n) && touched[k] < ncells;
+		if (ok)
+			delta[touched[k]] = n;
+	}
+
+	if (!ok) {
+		in.fail();
+		field.assign(ncells, 0);
+		counts.assign(ncells, 0);
+		touched.clear();
+	}
+	return ok;
+}
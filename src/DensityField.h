@@ -0,0 +1,120 @@
+/** \file DensityField.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef DensityField_H
+#define DensityField_H
+
+#include <memory>
+#include <vector>
+#include "Checkpoint.h"
+#include "DotStore.h"
+#include "FFT.h"
+
+/** Population density field over the whole world.
+ * For every position, holds the sum of 1/d^2 over all dots in other
+ * positions (d being the toroidal distance), along with the number of
+ * dots in that position. The field is the periodic convolution of the
+ * occupancy grid with the 1/d^2 kernel, computed with a 2D FFT.
+ *
+ * The field may also be kept up to date between steps: additions,
+ * removals and moves are queued, then applied by commit() as shifted
+ * copies of the kernel, or by a full convolution when there are too
+ * many of them.
+ */
+class DensityField
+{
+private:
+	int grid_w;
+	int grid_h;
+
+	/** 1/d^2 for every offset, 0 at the origin. */
+	std::vector<double> kernel;
+	/** Transform of the kernel (real, since the kernel is even). */
+	std::vector<double> kernel_hat;
+
+	std::unique_ptr<FFT> p_fft_w;
+	std::unique_ptr<FFT> p_fft_h;
+	std::vector<FFT::Complex> work;
+	std::vector<FFT::Complex> column;
+
+	std::vector<double> field;
+	std::vector<unsigned int> counts;
+
+	/** Queued occupancy changes, and the cells they touch. */
+	std::vector<int> delta;
+	std::vector<size_t> touched;
+
+	void transform2D(bool inverse);
+	void convolveCounts(void);
+	void recompute(void);
+	void applyKernel(size_t c, int n);
+	void queue(int x, int y, int n);
+
+public:
+	DensityField(void);
+
+	/** Prepare the kernel and transforms for a world of the given size.
+	 * Must be called before anything else.
+	 */
+	void reset(int w, int h);
+
+	/** Recompute the whole field from a world snapshot. */
+	void rebuild(const DotStore::Buffer& dots);
+
+	/** Queue a dot addition, to be applied on the next commit. */
+	void add(int x, int y);
+	/** Queue a dot removal, to be applied on the next commit. */
+	void remove(int x, int y);
+	/** Queue a dot move, to be applied on the next commit. */
+	void move(int ox, int oy, int nx, int ny);
+
+	/** Apply all queued changes to the field.
+	 * \param full whether to recompute the whole field from the
+	 * occupancy grid, discarding any accumulated round-off
+	 */
+	void commit(bool full = false);
+
+	/** Compare the field against a full recomputation.
+	 * \return the largest relative error over all positions near any dot
+	 * but their own
+	 */
+	double measureDrift(void);
+
+	/** Sum of 1/d^2 over the dots in every other position. */
+	double sumAt(int x, int y) const;
+
+	/** Number of dots in the given position. */
+	unsigned int countAt(int x, int y) const;
+
+	/** Add the field to a checkpoint, with its round-off and the
+	 * changes still queued. */
+	void save(Checkpoint::Writer& out) const;
+	/** Take the field back from a checkpoint, after reset() to the
+	 * same world size.
+	 * \return false if it could not be read or does not fit the world
+	 */
+	bool restore(Checkpoint::Reader& in);
+};
+
+#endif
@@ -0,0 +1,222 @@
+/** \file DensityTree.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class DensityTree
+#include "DensityTree.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+DensityTree::DensityTree(void)
+:	grid_w(1),
+	grid_h(1),
+	theta(0.5),
+	points(),
+	nodes()
+{
+}
+
+void DensityTree::reset(int w, int h, double theta)
+{
+	this->grid_w = w;
+	this->grid_h = h;
+	this->theta = theta;
+	points.clear();
+	nodes.clear();
+}
+
+void DensityTree::rebuild(const DotStore::Buffer& dots)
+{
+	points.clear();
+	nodes.clear();
+	for (unsigned int i = 0 ; i < dots.size() ; i++)
+		points.push_back(Point { dots.x[i], dots.y[i] });
+
+	build(0, points.size(), 0, 0, grid_w, grid_h);
+}
+
+int DensityTree::build(unsigned int first, unsigned int count, int x0, int y0, int x1, int y1)
+{
+	const int index = nodes.size();
+	nodes.push_back(Node());
+
+	double sx = 0, sy = 0;
+	for (unsigned int i = first ; i < first + count ; i++) {
+		sx += points[i].x;
+		sy += points[i].y;
+	}
+
+	Node node;
+	node.x0 = x0; node.y0 = y0; node.x1 = x1; node.y1 = y1;
+	node.first = first;
+	node.count = count;
+	node.cx = (count > 0) ? sx / count : x0;
+	node.cy = (count > 0) ? sy / count : y0;
+	fill(node.children, node.children + 4, -1);
+	node.leaf = (count <= LEAF_SIZE || (x1 - x0 <= 1 && y1 - y0 <= 1));
+
+	if (!node.leaf) {
+		// split in halves along each axis which can still be split
+		const int xm = (x1 - x0 > 1) ? (x0 + x1) / 2 : x1;
+		const int ym = (y1 - y0 > 1) ? (y0 + y1) / 2 : y1;
+
+		auto pbegin = points.begin() + first;
+		auto pend = pbegin + count;
+		auto xsplit = partition(pbegin, pend, [xm](const Point& p) { return p.x < xm; });
+		auto ysplit0 = partition(pbegin, xsplit, [ym](const Point& p) { return p.y < ym; });
+		auto ysplit1 = partition(xsplit, pend, [ym](const Point& p) { return p.y < ym; });
+
+		const unsigned int bounds[5] = {
+			first,
+			first + (unsigned int)(ysplit0 - pbegin),
+			first + (unsigned int)(xsplit - pbegin),
+			first + (unsigned int)(ysplit1 - pbegin),
+			first + count
+		};
+		const int rects[4][4] = {
+			{ x0, y0, xm, ym }, { x0, ym, xm, y1 },
+			{ xm, y0, x1, ym }, { xm, ym, x1, y1 }
+		};
+		for (int q = 0 ; q < 4 ; q++) {
+			const unsigned int n = bounds[q + 1] - bounds[q];
+			if (n > 0) {
+				node.children[q] = build(bounds[q], n,
+						rects[q][0], rects[q][1], rects[q][2], rects[q][3]);
+			}
+		}
+	}
+
+	nodes[index] = node;
+	return index;
+}
+
+double DensityTree::boxDistSqr(const Node& node, int x, int y) const
+{
+	// toroidal distance from (x,y) to the closest position in the node
+	int dx = 0;
+	if (x < node.x0 || x >= node.x1) {
+		int d1 = (node.x0 - x + grid_w) % grid_w;
+		int d2 = (x - (node.x1 - 1) + grid_w) % grid_w;
+		dx = min(d1, d2);
+	}
+	int dy = 0;
+	if (y < node.y0 || y >= node.y1) {
+		int d1 = (node.y0 - y + grid_h) % grid_h;
+		int d2 = (y - (node.y1 - 1) + grid_h) % grid_h;
+		dy = min(d1, d2);
+	}
+	return (double)dx*dx + (double)dy*dy;
+}
+
+double DensityTree::sumAt(int x, int y, unsigned int& same) const
+{
+	same = 0;
+	if (nodes.empty())
+		return 0;
+
+	double sum = 0;
+	const double theta2 = theta * theta;
+	int stack[64 * 4];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const Node& node = nodes[stack[--top]];
+
+		if (node.leaf) {
+			for (unsigned int i = node.first ; i < node.first + node.count ; i++) {
+				// same metric as Simulator::distSqr
+				int dx = abs(x - points[i].x);
+				if (dx > grid_w/2)
+					dx = grid_w - dx;
+				int dy = abs(y - points[i].y);
+				if (dy > grid_h/2)
+					dy = grid_h - dy;
+				if (dx == 0 && dy == 0)
+					same++;
+				else
+					sum += 1.0 / ((double)dx*dx + (double)dy*dy);
+			}
+			continue;
+		}
+
+		const double box2 = boxDistSqr(node, x, y);
+		const double size = max(node.x1 - node.x0, node.y1 - node.y0);
+		if (box2 > 0 && size * size < theta2 * box2) {
+			// far enough: all dots in the centre of mass
+			double dx = fabs(x - node.cx);
+			if (dx > grid_w * 0.5)
+				dx = grid_w - dx;
+			double dy = fabs(y - node.cy);
+			if (dy > grid_h * 0.5)
+				dy = grid_h - dy;
+			sum += node.count / (dx*dx + dy*dy);
+			continue;
+		}
+
+		for (int q = 0 ; q < 4 ; q++) {
+			if (node.children[q] >= 0)
+				stack[top++] = node.children[q];
+		}
+	}
+
+	return sum;
+}
+
+double DensityTree::measureError(unsigned int samples) const
+{
+	const unsigned int n = points.size();
+	if (n == 0)
+		return 0;
+
+	const unsigned int stride = max(1u, n / samples);
+	double error = 0;
+	for (unsigned int s = 0 ; s < n ; s += stride) {
+		const int x = points[s].x, y = points[s].y;
+
+		double exact = 0;
+		for (const Point& p : points) {
+			int dx = abs(x - p.x);
+			if (dx > grid_w/2)
+				dx = grid_w - dx;
+			int dy = abs(y - p.y);
+			if (dy > grid_h/2)
+				dy = grid_h - dy;
+			if (dx != 0 || dy != 0)
+				exact += 1.0 / ((double)dx*dx + (double)dy*dy);
+		}
+		if (exact <= 0)
+			continue;
+
+		unsigned int same;
+		error = max(error, fabs(sumAt(x, y, same) - exact) / exact);
+	}
+	return error;
+}
+
+size_t DensityTree::getMemoryUsage(void) const
+{
+	return DotStore::bytesOf(points) + DotStore::bytesOf(nodes);
+}
@@ -0,0 +1,103 @@
+/** \file DensityTree.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef DensityTree_H
+#define DensityTree_H
+
+#include <vector>
+#include "DotStore.h"
+
+/** Approximate population density over a quadtree (Barnes-Hut).
+ * The world is recursively split into quadrants, each node keeping its
+ * dot count and centre of mass. When summing 1/d^2 around a position, a
+ * node which is small enough as seen from there (its size over its
+ * toroidal distance under the opening angle) counts as all of its dots
+ * sitting in the centre of mass. Memory and time only depend on the
+ * number of dots, not on the size of the world.
+ */
+class DensityTree
+{
+private:
+	struct Point
+	{
+		DotStore::Coord x;
+		DotStore::Coord y;
+	};
+
+	struct Node
+	{
+		/** Covered rectangle, [x0,x1) x [y0,y1) */
+		int x0, y0, x1, y1;
+		/** Range of the node's points in <tt>points</tt> */
+		unsigned int first;
+		unsigned int count;
+		/** Centre of mass */
+		double cx, cy;
+		/** Child nodes, -1 where empty; none at all for a leaf */
+		int children[4];
+		bool leaf;
+	};
+
+	int grid_w;
+	int grid_h;
+	double theta;
+
+	std::vector<Point> points;
+	std::vector<Node> nodes;
+
+	int build(unsigned int first, unsigned int count, int x0, int y0, int x1, int y1);
+	double boxDistSqr(const Node& node, int x, int y) const;
+
+public:
+	/** Nodes with this many points or less are not split further. */
+	static constexpr unsigned int LEAF_SIZE = 8;
+
+	DensityTree(void);
+
+	/** Set the world size and opening angle.
+	 * \param theta opening angle; 0 makes every sum exact
+	 */
+	void reset(int w, int h, double theta);
+
+	/** Rebuild the tree from a world snapshot. */
+	void rebuild(const DotStore::Buffer& dots);
+
+	/** Approximate sum of 1/d^2 over the dots in every other position.
+	 * \param x
+	 * \param y the position to evaluate
+	 * \param same set to the number of dots in that very position
+	 */
+	double sumAt(int x, int y, unsigned int& same) const;
+
+	/** Compare the tree's sums against the exact kernel sums, in up to
+	 * <tt>samples</tt> dot positions. This costs a full scan per sample.
+	 * \return the largest relative error found
+	 */
+	double measureError(unsigned int samples = 1024) const;
+
+	/** \return the bytes held by the tree's points and nodes */
+	size_t getMemoryUsage(void) const;
+};
+
+#endif
@@ -27,38 +27,49 @@
 //enum DotStatus
 #include "Dot.h"
 
-#include <array>
 
-unsigned int Dot::current_id = 0;
+DotId Dot::current_id = 0;
 
 Dot::Dot(void)
-:   p_dotconf(nullptr)
-,   id(0)
+:   id(0)
 ,	x(0), y(0)
 ,   count(0), age(0), type(DotType::DOT_ALPHA)
 ,	status(STATUS_INVALID), partner(0), has_partner(false)
 {
 }
 
-Dot::Dot(unsigned int id, int nX, int nY, DotType ntype, const DotConf& dconf)
-:   p_dotconf(&dconf)
-,   id(id)
+Dot::Dot(DotId id, int nX, int nY, DotType ntype)
+:   id(id)
 ,	x(nX), y(nY)
 ,   count(0), age(0), type(ntype)
 ,	status(STATUS_NORMAL), partner(0), has_partner(false)
 {
 }
 
-Dot Dot::create(int nX, int nY, DotType ntype, const DotConf& dconf)
+Dot::Dot(DotId id, int nX, int nY, DotType ntype, DotStatus nstatus,
+		unsigned int nage, int ncount, DotId npartner, bool nhas_partner)
+:   id(id)
+,	x(nX), y(nY)
+,   count(ncount), age(nage), type(ntype)
+,	status(nstatus), partner(npartner), has_partner(nhas_partner)
 {
-    return Dot(current_id++, nX, nY, ntype, dconf);
+}
+
+Dot Dot::create(int nX, int nY, DotType ntype)
+{
+    return Dot(newID(), nX, nY, ntype);
+}
+
+DotId Dot::newID(void)
+{
+	return current_id++;
 }
 
 Dot::~Dot()
 {
 }
 
-unsigned int Dot::getID() const { return this->id; }
+DotId Dot::getID() const { return this->id; }
 
 int Dot::getX() const {	return this->x; }
 
@@ -84,7 +95,7 @@ void Dot::incCount() {
 	this->count++;
 }
 
-unsigned int Dot::getPartnerId() const {
+DotId Dot::getPartnerId() const {
 	return this->partner;
 }
 
@@ -113,93 +124,6 @@ bool Dot::operator!=(const Dot& other) const {
 	return this->getID() != other.getID();
 }
 
-void Dot::updateCDF(double pdensity) {
-    if (this->status == STATUS_INVALID) return;
-
-    constexpr int N = 6; // 6 stands for six possible Dot states
-
-	//double tmp;
-	std::array<double,N> pdf;
-
-    pdf.fill(0);
-
-	//death - 1
-	pdf[1] = (double)this->age/this->p_dotconf->death_chance_maj;
-	pdf[1] *= pdf[1]; //squared
-
-	switch (this->status)
-	{
-	//default:
-
-	case STATUS_NORMAL:
-		//Null Probability:
-		//	eating - 4
-		//	generating - 5
-
-		//hungry - 2
-		pdf[2] = (1-pdf[1]) * this->p_dotconf->hunger_chance;
-
-		//looking - 3
-		pdf[3] = (1-pdf[1]-pdf[2]) * this->p_dotconf->look_prob.getPDF(this->age);
-
-		//normal - 0
-		pdf[0] = 1 - pdf[1] - pdf[2] - pdf[3];
-
-	break;
-	case STATUS_HUNGRY:
-	{
-		//Null Probability:
-		//	normal - 0
-		//	looking - 3
-		//	generating - 5
-
-		//eating - 4
-		pdf[4] = (1 - pdf[1]) * (1 / (pdensity + 1));
-
-		//hungry - 2
-		pdf[2] = 1 - pdf[1] - pdf[4];
-
-	}
-	break;
-	case STATUS_LOOKING:
-		//Null Probability:
-		//	get hungry - 2
-		//	eating - 4
-		//	normal - 0
-		//	PROCEDURAL: generating - 5
-
-		// searching dot - 3
-		pdf[3] = 1 - pdf[1];
-	break;
-	case STATUS_EATING:
-		//Null Probability:
-		//	PROCEDURAL: normal - 0
-		//	get hungry - 2
-		//	get looking - 3
-		//	generating - 5
-
-		//eating - 4
-		pdf[4] = 1 - pdf[1];
-	break;
-	case STATUS_GENERATING:
-		//Null Probability:
-		//	PROCEDURAL: normal - 0
-		//	get hungry - 2
-		//	get looking - 3
-		//	eating - 4
-
-		//generating - 5
-		pdf[5] = 1 - pdf[1];
-
-	break;
-    default:
-    break;
-	}
-
-	//set cdf
-	RandGenerator::pdf2cdf(pdf.data(), this->status_cdf.data(), N);
-}
-
 void Dot::move(int d)
 {
     if (this->status == STATUS_INVALID) return;
@@ -260,8 +184,3 @@ const char* Dot::statusToString() const
 		default: return "HAX";
 	}
 }
-
-const double* Dot::getCDF()
-{
-	return this->status_cdf.data();
-}
@@ -31,9 +31,8 @@
 #include "RandGenerator.h"
 #include <stdlib.h>
 #include <ostream>
-#include <array>
 
-enum DotStatus : int
+enum DotStatus : signed char
 {
 	STATUS_INVALID		= -1,
 	STATUS_NORMAL		= 0,
@@ -49,18 +48,18 @@ enum class DotType : bool
 	DOT_ALPHA,
 	DOT_BETA
 };
+
+/** Dot ID, wide enough for any number of births in a run. */
+using DotId = unsigned long long;
 
 class Dot
 {
 
 private:
-	static unsigned int current_id;
+	static DotId current_id;
 
-    /** Reference to Dot configurations. */
-    const DotConf* p_dotconf;
-
     /** Dot's ID */
-	unsigned int id;
+	DotId id;
     /** x position in the world */
 	unsigned int x;
     /** y position in the world */
@@ -69,14 +68,12 @@ private:
 	int count;
     /** The Dot's age */
 	unsigned int age;
-    /** State transition chances. */
-	std::array<double,6> status_cdf;
     /** Dot type (Alpha / Beta) */
 	DotType type;
     /** The Dot's current status (state) */
 	DotStatus status;
     /** ID of the generation parter. */
-	unsigned int partner;
+	DotId partner;
 	/** Whether it has a partner. */
 	bool has_partner;
 
@@ -84,7 +81,10 @@ public:
     /** Default constructor. */
 	Dot(void);
     /** Main constructor. */
-	Dot(unsigned int id, int nX, int nY, DotType ntype, const DotConf& dconf);
+	Dot(DotId id, int nX, int nY, DotType ntype);
+	/** Constructor with every attribute, for views of stored dots. */
+	Dot(DotId id, int nX, int nY, DotType ntype, DotStatus nstatus,
+			unsigned int nage, int ncount, DotId npartner, bool nhas_partner);
     /** Copy constructor. */
     Dot(const Dot& other) = default;
     /** Move constructor. */
@@ -100,7 +100,7 @@ public:
     Dot& operator=(Dot&& other) = default;
 
     /** Dot ID getter. */
-	unsigned int getID() const;
+	DotId getID() const;
 	/** Dot X getter. */
 	int getX() const;
 	/** Dot Y getter. */
@@ -135,7 +135,7 @@ public:
 	/** Get ID of Dot's partner.
 	 * \return a dot ID, only makes sense if it has a partner.
 	 */
-	unsigned int getPartnerId() const;
+	DotId getPartnerId() const;
 
 	/** Check for partner.
 	 * \return whether the dot has a partner.
@@ -148,8 +148,6 @@ public:
 	/** Dot's partner resetter (clears partner). */
 	void resetPartner(void);
 
-	const double* getCDF();
-
     /** Compares two dots by ID. */
 	bool operator== (const Dot& other) const;
 
@@ -168,14 +166,16 @@ public:
      */
 	void move(int d);
 
-	void updateCDF(double pdensity = 0);
-
 	std::ostream& report(std::ostream& stream) const;
 
 	const char* typeToString() const;
 	const char* statusToString() const;
 
-    static Dot create(int nX, int nY, DotType ntype, const DotConf& dconf);
+    static Dot create(int nX, int nY, DotType ntype);
+
+	/** Take a new, never used dot ID. Simulators number their dots
+	 * themselves, this is for stand-alone dots. */
+	static DotId newID(void);
 };
 
 #endif
@@ -33,9 +33,22 @@ DotConf::DotConf()
 	death_chance_maj(1000.0),
 	looking_chance_mean(150.0),
 	looking_chance_var(16.0),
+	looking_chance_p(1.0),
 	eat_time(3),
 	generation_time(4),
-	look_prob()
+	density_mode(DensityMode::DENSITY_DIRECT),
+	density_rebuild_period(256),
+	density_theta(0.5),
+	density_single(false),
+	step_mode(StepMode::STEP_SERIAL),
+	step_threads(0),
+	rng_mode(RngMode::RNG_COUNTER),
+	schedule_mode(ScheduleMode::SCHEDULE_STEPS),
+	nearest_check(false),
+	profile(false),
+	profile_period(0),
+	look_prob(),
+	transitions()
 {
     updateLookProb();
 }
@@ -46,9 +59,22 @@ DotConf::DotConf(const DotConf& other)
 	death_chance_maj(other.death_chance_maj),
 	looking_chance_mean(other.looking_chance_mean),
 	looking_chance_var(other.looking_chance_var),
+	looking_chance_p(other.looking_chance_p),
 	eat_time(other.eat_time),
 	generation_time(other.generation_time),
-	look_prob(other.look_prob)
+	density_mode(other.density_mode),
+	density_rebuild_period(other.density_rebuild_period),
+	density_theta(other.density_theta),
+	density_single(other.density_single),
+	step_mode(other.step_mode),
+	step_threads(other.step_threads),
+	rng_mode(other.rng_mode),
+	schedule_mode(other.schedule_mode),
+	nearest_check(other.nearest_check),
+	profile(other.profile),
+	profile_period(other.profile_period),
+	look_prob(other.look_prob),
+	transitions(other.transitions)
 {
 }
 
@@ -58,9 +84,22 @@ DotConf::DotConf(DotConf&& other)
 	death_chance_maj(other.death_chance_maj),
 	looking_chance_mean(other.looking_chance_mean),
 	looking_chance_var(other.looking_chance_var),
+	looking_chance_p(other.looking_chance_p),
 	eat_time(other.eat_time),
 	generation_time(other.generation_time),
-	look_prob(other.look_prob)
+	density_mode(other.density_mode),
+	density_rebuild_period(other.density_rebuild_period),
+	density_theta(other.density_theta),
+	density_single(other.density_single),
+	step_mode(other.step_mode),
+	step_threads(other.step_threads),
+	rng_mode(other.rng_mode),
+	schedule_mode(other.schedule_mode),
+	nearest_check(other.nearest_check),
+	profile(other.profile),
+	profile_period(other.profile_period),
+	look_prob(other.look_prob),
+	transitions(other.transitions)
 {
 }
 
@@ -70,4 +109,5 @@ void DotConf::updateLookProb(void)
                 looking_chance_mean,
                 looking_chance_var,
                 looking_chance_p);
+	this->transitions.build(hunger_chance, death_chance_maj, look_prob);
 }
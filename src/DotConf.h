@@ -28,6 +28,39 @@
 #define DotConf_H
 
 #include "GaussFunc.h"
+#include "TransitionTable.h"
+
+/** How the population density around each dot is evaluated. */
+enum class DensityMode : int
+{
+	DENSITY_DIRECT,		// sum over every other dot, for every dot
+	DENSITY_FFT,		// whole field by FFT convolution, once per step
+	DENSITY_INCREMENTAL,	// field kept up to date from moves, births and deaths
+	DENSITY_TREE		// Barnes-Hut approximation over a quadtree
+};
+
+/** How the dots are stepped. */
+enum class StepMode : int
+{
+	STEP_SERIAL,		// one by one, in slot order
+	STEP_PARALLEL		// on a thread pool, same frames for any number of threads
+};
+
+/** Where the dots' random draws come from. */
+enum class RngMode : int
+{
+	RNG_GLOBAL,		// the simulator's own additive generator, drawn in stepping order
+	RNG_COUNTER		// counter-based streams keyed by seed, frame, dot ID and draw
+};
+
+/** When dots roll for death. */
+enum class ScheduleMode : int
+{
+	SCHEDULE_STEPS,		// at every step
+	SCHEDULE_EVENTS,	// eating and generating dots once, as they start, for
+						// the step they die or stop in
+	SCHEDULE_LIFETIMES	// every dot once, as it is born, for the step it dies in
+};
 
 struct DotConf
 {
@@ -45,9 +78,45 @@ struct DotConf
 	int eat_time;				// 10
 	int generation_time;		// 11
 
+	/** Density evaluation engine (not part of config.txt) */
+	DensityMode density_mode;
+	/** Frames between full rebuilds of an incremental density field,
+	 * 0 for never (not part of config.txt) */
+	int density_rebuild_period;
+	/** Opening angle of the approximate density tree, not negative; 0
+	 * walks the whole tree for exact sums (not part of config.txt) */
+	double density_theta;
+	/** Whether direct density sums are done in single precision
+	 * (not part of config.txt) */
+	bool density_single;
+
+	/** Stepping engine (not part of config.txt) */
+	StepMode step_mode;
+	/** Threads stepping dots in STEP_PARALLEL mode, 0 for one per
+	 * hardware thread (not part of config.txt) */
+	unsigned int step_threads;
+	/** Random draw source (not part of config.txt) */
+	RngMode rng_mode;
+	/** Status scheduling engine (not part of config.txt) */
+	ScheduleMode schedule_mode;
+	/** Whether every nearest dot query is checked against a full scan,
+	 * which makes steps quadratic; for debugging (not part of config.txt) */
+	bool nearest_check;
+
+	/** Whether steps are profiled, see Simulator::getProfile
+	 * (not part of config.txt) */
+	bool profile;
+	/** Frames between dumps of the profile to stderr, 0 for none
+	 * (not part of config.txt) */
+	unsigned int profile_period;
+
     /** Probability table of reaching "LOOKING" state for all dots */
 	GaussFunc look_prob;
+	/** Status transition chances of all dots, built from the above */
+	TransitionTable transitions;
 
+	/** Rebuild look_prob and transitions, after any of the chances
+	 * above has changed. */
     void updateLookProb(void);
 
 public:
@@ -0,0 +1,196 @@
+/** \file DotRenderer.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class DotRenderer
+#define GL_GLEXT_PROTOTYPES
+#include "DotRenderer.h"
+#include <cstddef>
+#include <cstdio>
+
+using namespace std;
+
+DotRenderer::DotRenderer(void)
+:	vertices(),
+	count(0),
+	use_buffer(false),
+	buffer(0),
+	buffer_capacity(0)
+{
+	for (int t = 0 ; t < 2 ; t++) {
+		const DotType type = t ? DotType::DOT_BETA : DotType::DOT_ALPHA;
+		for (int s = 0 ; s < 6 ; s++) {
+			float rgb[3];
+			colorOf(type, (DotStatus)s, rgb);
+			for (int c = 0 ; c < 3 ; c++)
+				colors[t][s][c] = (GLubyte)(rgb[c] * 255 + 0.5f);
+			colors[t][s][3] = 255;
+		}
+	}
+}
+
+DotRenderer::~DotRenderer()
+{
+	if (buffer != 0)
+		glDeleteBuffers(1, &buffer);
+}
+
+void DotRenderer::init(void)
+{
+	// buffer objects are core since GL 1.5
+	int major = 0, minor = 0;
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if (version == nullptr || sscanf(version, "%d.%d", &major, &minor) != 2)
+		return;
+	use_buffer = (major > 1 || (major == 1 && minor >= 5));
+	if (use_buffer)
+		glGenBuffers(1, &buffer);
+}
+
+void DotRenderer::update(const DotStore::Buffer& dots)
+{
+	fill(dots.size(), dots.x.data(), dots.y.data(), dots.type.data(), dots.status.data());
+}
+
+void DotRenderer::update(const Trajectory::Frame& frame)
+{
+	fill(frame.size(), frame.x.data(), frame.y.data(), frame.type.data(), frame.status.data());
+}
+
+void DotRenderer::update(const SimThread::Snapshot& snapshot)
+{
+	fill(snapshot.size(), snapshot.x.data(), snapshot.y.data(), snapshot.type.data(), snapshot.status.data());
+}
+
+template <typename Pos>
+void DotRenderer::fill(unsigned int n, const Pos* x, const Pos* y,
+		const DotType* type, const DotStatus* status)
+{
+	count = 4 * n;
+	if (vertices.size() < count)
+		vertices.resize(count);
+
+	Vertex* v = vertices.data();
+	for (unsigned int i = 0 ; i < n ; i++, v += 4) {
+		const GLfloat x0 = x[i], y0 = y[i];
+		const int s = (status[i] >= STATUS_NORMAL && status[i] <= STATUS_GENERATING)
+				? status[i] : STATUS_NORMAL;
+		const GLubyte* color = colors[type[i] == DotType::DOT_BETA][s];
+
+		v[0].x = x0;		v[0].y = y0;
+		v[1].x = x0 + 1;	v[1].y = y0;
+		v[2].x = x0 + 1;	v[2].y = y0 + 1;
+		v[3].x = x0;		v[3].y = y0 + 1;
+		for (int k = 0 ; k < 4 ; k++) {
+			v[k].color[0] = color[0];
+			v[k].color[1] = color[1];
+			v[k].color[2] = color[2];
+			v[k].color[3] = color[3];
+		}
+	}
+
+	if (!use_buffer || count == 0)
+		return;
+
+	// a new store each time the buffer grows, a fresh one of the same size
+	// otherwise, so that the driver needs not wait for the previous draw
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	if (count > buffer_capacity)
+		buffer_capacity = vertices.size();
+	glBufferData(GL_ARRAY_BUFFER, buffer_capacity * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Vertex), vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DotRenderer::draw(void) const
+{
+	if (count == 0)
+		return;
+
+	const char* base = (const char*)vertices.data();
+	if (use_buffer) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		base = nullptr;
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), base + offsetof(Vertex, x));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), base + offsetof(Vertex, color));
+
+	glDrawArrays(GL_QUADS, 0, count);
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (use_buffer)
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool DotRenderer::usesBuffer(void) const
+{
+	return use_buffer;
+}
+
+void DotRenderer::colorOf(DotType type, DotStatus status, float rgb[3])
+{
+	const bool isAlpha = (type == DotType::DOT_ALPHA);
+	float r, g, b;
+	switch (status)
+	{
+	case STATUS_DEAD:
+		r = 0.8f; g = 0.8f; b = 0.8f;	//White for dead
+		break;
+	case STATUS_LOOKING:
+		if (isAlpha) {
+			r = 1.0f; g = 0.2f; b = 0.4f;
+		} else {
+			r = 0.4f; g = 0.2f; b = 1.0f;
+		}
+		break;
+	case STATUS_GENERATING:
+		r = 1.0f; g = 0.2f; b = 1.0f;	//Magenta for generating
+		break;
+	case STATUS_HUNGRY:
+		if (isAlpha) {
+			r = 0.5f; g = 0.1f; b = 0.0f;
+		} else {
+			r = 0.0f; g = 0.1f; b = 0.5f;
+		}
+		break;
+	case STATUS_EATING:
+		if (isAlpha) {
+			r = 0.8f; g = 0.4f; b = 0.1f;
+		} else {
+			r = 0.1f; g = 0.4f; b = 0.8f;
+		}
+		break;
+	default:
+		if (isAlpha) {
+			r = 1.0f; g = 0.1f; b = 0.0f;
+		} else {
+			r = 0.0f; g = 0.1f; b = 1.0f;
+		}
+		break;
+	}
+	rgb[0] = r; rgb[1] = g; rgb[2] = b;
+}
@@ -0,0 +1,100 @@
+/** \file DotRenderer.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef DotRenderer_H
+#define DotRenderer_H
+
+#include <vector>
+#include <GL/gl.h>
+#include "Dot.h"
+#include "DotStore.h"
+#include "SimThread.h"
+#include "Trajectory.h"
+
+/** Draws every dot of a frame in a single call.
+ * Each dot is a quad of four vertices, with its position and its colour
+ * interleaved, all in one array which is rebuilt from the dot arrays for
+ * every frame. The array goes to a vertex buffer object when the GL
+ * version has them (1.5 and up, which includes software Mesa), and is
+ * drawn from client memory otherwise. Once the array has grown to the
+ * size of the population, updates allocate no memory.
+ */
+class DotRenderer
+{
+private:
+	struct Vertex
+	{
+		GLfloat x;
+		GLfloat y;
+		GLubyte color[4];
+	};
+
+	/** Colour of every status, for each type (see colorOf) */
+	GLubyte colors[2][6][4];
+
+	std::vector<Vertex> vertices;
+	/** Number of vertices of the current frame */
+	unsigned int count;
+
+	/** Whether the buffer object is used, once init() has been called */
+	bool use_buffer;
+	GLuint buffer;
+	/** Vertices the buffer object can hold */
+	unsigned int buffer_capacity;
+
+	/** Make the quads of n dots, positions being DotStore::Coord or int */
+	template <typename Pos>
+	void fill(unsigned int n, const Pos* x, const Pos* y,
+			const DotType* type, const DotStatus* status);
+
+public:
+	DotRenderer(void);
+	~DotRenderer();
+
+	DotRenderer(const DotRenderer&) = delete;
+	DotRenderer& operator=(const DotRenderer&) = delete;
+
+	/** Create the buffer object. Must be called once there is a current
+	 * GL context, before the first update. */
+	void init(void);
+
+	/** Take the dots of a world snapshot or of a recorded frame, replacing
+	 * the previous ones. */
+	void update(const DotStore::Buffer& dots);
+	void update(const Trajectory::Frame& frame);
+	void update(const SimThread::Snapshot& snapshot);
+
+	/** Draw the dots of the last update, in world coordinates. */
+	void draw(void) const;
+
+	/** \return whether the dots are drawn from a buffer object */
+	bool usesBuffer(void) const;
+
+	/** Colour of a dot, as drawn.
+	 * \param rgb set to the red, green and blue components
+	 */
+	static void colorOf(DotType type, DotStatus status, float rgb[3]);
+};
+
+#endif
@@ -0,0 +1,95 @@
+/** \file DotSchedule.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class DotSchedule
+#include "DotSchedule.h"
+#include <algorithm>
+
+using namespace std;
+
+static_assert(sizeof(DotSchedule::Event) == 16, "events are saved bytewise, without padding");
+
+DotSchedule::DotSchedule(void)
+:	events()
+{
+}
+
+bool DotSchedule::later(const Event& a, const Event& b)
+{
+	return a.frame > b.frame || (a.frame == b.frame && a.id > b.id);
+}
+
+void DotSchedule::clear(void)
+{
+	events.clear();
+}
+
+void DotSchedule::add(const Event& event)
+{
+	events.push_back(event);
+	push_heap(events.begin(), events.end(), later);
+}
+
+bool DotSchedule::next(unsigned int frame, Event& event)
+{
+	if (events.empty() || events.front().frame > frame)
+		return false;
+	pop_heap(events.begin(), events.end(), later);
+	event = events.back();
+	events.pop_back();
+	return true;
+}
+
+unsigned int DotSchedule::size(void) const
+{
+	return events.size();
+}
+
+size_t DotSchedule::getMemoryUsage(void) const
+{
+	return DotStore::bytesOf(events);
+}
+
+void DotSchedule::save(Checkpoint::Writer& out) const
+{
+	// in heap order, to be taken back as it is
+	out.array(events);
+}
+
+bool DotSchedule::restore(Checkpoint::Reader& in)
+{
+	in.array(events);
+	bool ok = in.good() && is_heap(events.begin(), events.end(), later);
+	for (size_t k = 0 ; ok && k < events.size() ; k++) {
+		// end was read as a raw byte, which a bool may not hold
+		const unsigned char end = *reinterpret_cast<const unsigned char*>(&events[k].end);
+		ok = (events[k].status == STATUS_EATING || events[k].status == STATUS_GENERATING)
+				&& end <= 1;
+	}
+	if (!ok) {
+		in.fail();
+		events.clear();
+	}
+	return ok;
+}
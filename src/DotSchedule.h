@@ -0,0 +1,90 @@
+/** \file DotSchedule.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef DotSchedule_H
+#define DotSchedule_H
+
+#include <vector>
+#include "Checkpoint.h"
+#include "Dot.h"
+#include "DotStore.h"
+
+/** Queue of the dots' next status changes, by frame (SCHEDULE_EVENTS).
+ * A dot which starts eating or generating can only die or, once its
+ * count reaches eat_time or generation_time, stop. Both happen on a
+ * known step, drawn as it starts, so it gets a single event for the
+ * first of them; until then it is stepped without rolling at all.
+ *
+ * Events are not removed when a dot changes status some other way: they
+ * are checked against the dot as they come due, and dropped if its
+ * status or count no longer match.
+ */
+class DotSchedule
+{
+public:
+	struct Event
+	{
+		DotId id;
+		/** Step in which it happens */
+		unsigned int frame;
+		/** The dot's count as that step starts */
+		DotStore::Count count;
+		/** The dot's status until then */
+		DotStatus status;
+		/** Whether the status comes to its end, rather than the dot dying */
+		bool end;
+	};
+
+private:
+	/** Binary heap, the earliest event (the lowest ID first) on top */
+	std::vector<Event> events;
+
+	static bool later(const Event& a, const Event& b);
+
+public:
+	DotSchedule(void);
+
+	void clear(void);
+	void add(const Event& event);
+
+	/** Take the next event due by the given frame.
+	 * \return false if there is none
+	 */
+	bool next(unsigned int frame, Event& event);
+
+	/** \return the number of events, stale ones included */
+	unsigned int size(void) const;
+
+	/** \return the bytes held by the queue */
+	size_t getMemoryUsage(void) const;
+
+	/** Add the queue to a checkpoint. */
+	void save(Checkpoint::Writer& out) const;
+	/** Take the queue back from a checkpoint.
+	 * \return false if it could not be read
+	 */
+	bool restore(Checkpoint::Reader& in);
+};
+
+#endif
@@ -0,0 +1,373 @@
+/** \file DotStore.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class DotStore
+#include "DotStore.h"
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+constexpr unsigned int DotStore::NO_SLOT;
+constexpr unsigned int DotStore::SPARE_BUCKETS;
+constexpr DotId DotStore::NO_PARTNER;
+constexpr unsigned int DotStore::N_STATUSES;
+constexpr int DotStore::MAX_GRID;
+constexpr int DotStore::MAX_COUNT;
+constexpr size_t DotStore::SLOT_BUDGET;
+constexpr size_t DotStore::SLOT_BYTES;
+
+// every byte counts with tens of millions of dots
+static_assert(sizeof(DotStatus) == 1 && sizeof(DotType) == 1,
+		"statuses and types must take a byte each");
+#ifndef DOTS_WIDE_COORDS
+static_assert(DotStore::SLOT_BYTES <= DotStore::SLOT_BUDGET, "dot attributes over their budget");
+#endif
+
+unsigned int DotStore::Buffer::size(void) const
+{
+	return id.size();
+}
+
+bool DotStore::Buffer::empty(void) const
+{
+	return id.empty();
+}
+
+DotStore::Census::Census(void)
+{
+	for (auto& row : counts)
+		fill(begin(row), end(row), 0u);
+}
+
+unsigned int DotStore::Census::of(DotType type, DotStatus status) const
+{
+	return counts[type == DotType::DOT_BETA][status];
+}
+
+unsigned int DotStore::Census::ofType(DotType type) const
+{
+	const unsigned int* row = counts[type == DotType::DOT_BETA];
+	return accumulate(row, row + N_STATUSES, 0u);
+}
+
+unsigned int DotStore::Census::ofStatus(DotStatus status) const
+{
+	return counts[0][status] + counts[1][status];
+}
+
+unsigned int DotStore::Census::total(void) const
+{
+	return ofType(DotType::DOT_ALPHA) + ofType(DotType::DOT_BETA);
+}
+
+DotStore::DotStore(void)
+:	buffers(),
+	front_index(0),
+	stepping(false),
+	id_base(0),
+	id_shift(0),
+	firsts(),
+	growths(0)
+{
+}
+
+const DotStore::Buffer& DotStore::front(void) const
+{
+	return buffers[front_index];
+}
+
+DotStore::Buffer& DotStore::back(void)
+{
+	return buffers[front_index ^ 1];
+}
+
+const DotStore::Buffer& DotStore::back(void) const
+{
+	return buffers[front_index ^ 1];
+}
+
+unsigned int DotStore::size(void) const
+{
+	return front().size();
+}
+
+bool DotStore::empty(void) const
+{
+	return front().empty();
+}
+
+void DotStore::resize(Buffer& buf, unsigned int n)
+{
+	if (n > buf.id.capacity())
+		growths++;
+
+	buf.id.resize(n);
+	buf.x.resize(n);
+	buf.y.resize(n);
+	buf.birth.resize(n);
+	buf.count.resize(n);
+	buf.status.resize(n);
+	buf.type.resize(n);
+	buf.partner.resize(n);
+}
+
+void DotStore::push(Buffer& buf, DotId nid, int nx, int ny, DotType ntype, unsigned int nbirth)
+{
+	if (buf.id.size() == buf.id.capacity())
+		growths++;
+
+	buf.id.push_back(nid);
+	buf.x.push_back(nx);
+	buf.y.push_back(ny);
+	buf.birth.push_back(nbirth);
+	buf.count.push_back(0);
+	buf.status.push_back(STATUS_NORMAL);
+	buf.type.push_back(ntype);
+	buf.partner.push_back(NO_PARTNER);
+}
+
+unsigned int DotStore::add(DotId nid, int nx, int ny, DotType ntype, unsigned int nbirth)
+{
+	Buffer& buf = stepping ? back() : buffers[front_index];
+	const unsigned int slot = buf.size();
+	if (slot == 0) {
+		id_base = nid;
+		id_shift = 0;
+		firsts.assign(1, 0);
+	}
+	push(buf, nid, nx, ny, ntype, nbirth);
+
+	// buckets up to the new dot's start at its slot, and the end moves past it
+	const DotId bucket = (nid - id_base) >> id_shift;
+	firsts.pop_back();
+	if (bucket >= 2 * ((DotId)slot + 1 + SPARE_BUCKETS)) {
+		reindex();
+		return slot;
+	}
+	if (bucket + 2 > firsts.capacity())
+		growths++;
+	firsts.resize(bucket + 1, slot);
+	firsts.push_back(slot + 1);
+	return slot;
+}
+
+unsigned int DotStore::removeDead(void)
+{
+	Buffer& buf = buffers[front_index];
+	const unsigned int n = buf.size();
+	unsigned int kept = 0;
+	for (unsigned int i = 0 ; i < n ; i++) {
+		if (buf.status[i] == STATUS_DEAD)
+			continue;
+		if (kept != i) {
+			buf.id[kept] = buf.id[i];
+			buf.x[kept] = buf.x[i];
+			buf.y[kept] = buf.y[i];
+			buf.birth[kept] = buf.birth[i];
+			buf.count[kept] = buf.count[i];
+			buf.status[kept] = buf.status[i];
+			buf.type[kept] = buf.type[i];
+			buf.partner[kept] = buf.partner[i];
+		}
+		kept++;
+	}
+	if (kept == n)
+		return 0;
+
+	resize(buf, kept);
+
+	// the table only needs to cover the surviving IDs
+	reindex();
+	return n - kept;
+}
+
+DotId DotStore::idAt(unsigned int slot) const
+{
+	const Buffer& buf = front();
+	return (slot < buf.size()) ? buf.id[slot] : back().id[slot];
+}
+
+void DotStore::reindex(void)
+{
+	const unsigned int n = stepping ? back().size() : size();
+	firsts.clear();
+	id_base = 0;
+	id_shift = 0;
+	if (n == 0)
+		return;
+
+	id_base = idAt(0);
+	const DotId span = idAt(n - 1) - id_base;
+	while ((span >> id_shift) >= (DotId)n + SPARE_BUCKETS)
+		id_shift++;
+	firsts.reserve((span >> id_shift) + 2);
+	for (unsigned int i = 0 ; i < n ; i++)
+		firsts.resize(((idAt(i) - id_base) >> id_shift) + 1, i);
+	firsts.push_back(n);
+}
+
+void DotStore::beginStep(void)
+{
+	resize(back(), size());
+	stepping = true;
+}
+
+void DotStore::load(unsigned int slot)
+{
+	const Buffer& src = front();
+	Buffer& dst = back();
+	dst.id[slot] = src.id[slot];
+	dst.x[slot] = src.x[slot];
+	dst.y[slot] = src.y[slot];
+	dst.birth[slot] = src.birth[slot];
+	dst.count[slot] = src.count[slot];
+	dst.status[slot] = src.status[slot];
+	dst.type[slot] = src.type[slot];
+	dst.partner[slot] = src.partner[slot];
+}
+
+void DotStore::endStep(void)
+{
+	front_index ^= 1;
+	stepping = false;
+}
+
+unsigned int DotStore::slotOf(DotId nid) const
+{
+	if (nid < id_base || firsts.empty())
+		return NO_SLOT;
+	const DotId bucket = (nid - id_base) >> id_shift;
+	if (bucket + 1 >= firsts.size())
+		return NO_SLOT;
+
+	// about one dot per bucket, still in ID order
+	unsigned int low = firsts[bucket], high = firsts[bucket + 1];
+	while (low < high) {
+		const unsigned int mid = low + (high - low) / 2;
+		if (idAt(mid) < nid)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return (low < firsts[bucket + 1] && idAt(low) == nid) ? low : NO_SLOT;
+}
+
+DotStore::Range DotStore::range(unsigned int frame) const
+{
+	return Range(front(), frame);
+}
+
+DotStore::Census DotStore::census(void) const
+{
+	const Buffer& buf = front();
+	Census result;
+	for (unsigned int i = 0 ; i < buf.size() ; i++)
+		result.counts[buf.type[i] == DotType::DOT_BETA][buf.status[i]]++;
+	return result;
+}
+
+Dot DotStore::view(unsigned int slot, unsigned int frame) const
+{
+	const Buffer& buf = front();
+	return Dot(buf.id[slot], buf.x[slot], buf.y[slot], buf.type[slot], buf.status[slot],
+			ageOf(buf.birth[slot], buf.status[slot], frame), buf.count[slot],
+			buf.partner[slot], buf.partner[slot] != NO_PARTNER);
+}
+
+unsigned long DotStore::getGrowths(void) const
+{
+	return growths;
+}
+
+size_t DotStore::getMemoryUsage(void) const
+{
+	size_t bytes = bytesOf(firsts);
+	for (const Buffer& buf : buffers) {
+		bytes += bytesOf(buf.id) + bytesOf(buf.x) + bytesOf(buf.y) + bytesOf(buf.birth)
+				+ bytesOf(buf.count) + bytesOf(buf.status) + bytesOf(buf.type)
+				+ bytesOf(buf.partner);
+	}
+	return bytes;
+}
+
+void DotStore::save(Checkpoint::Writer& out) const
+{
+	const Buffer& buf = front();
+	// positions are only readable by builds of the same width
+	out.value((unsigned int)sizeof(Coord));
+	out.array(buf.id);
+	out.array(buf.x);
+	out.array(buf.y);
+	out.array(buf.birth);
+	out.array(buf.count);
+	out.array(buf.status);
+	out.array(buf.type);
+	out.array(buf.partner);
+}
+
+bool DotStore::restore(Checkpoint::Reader& in, int w, int h, DotId next_id, unsigned int frame)
+{
+	Buffer& buf = buffers[front_index];
+	unsigned int coord_size = 0;
+	in.value(coord_size);
+	if (coord_size != sizeof(Coord))
+		in.fail();
+	in.array(buf.id);
+	in.array(buf.x);
+	in.array(buf.y);
+	in.array(buf.birth);
+	in.array(buf.count);
+	in.array(buf.status);
+	in.array(buf.type);
+	in.array(buf.partner);
+
+	const unsigned int n = buf.size();
+	bool ok = in.good() && buf.x.size() == n && buf.y.size() == n && buf.birth.size() == n
+			&& buf.count.size() == n && buf.status.size() == n
+			&& buf.type.size() == n && buf.partner.size() == n;
+	for (unsigned int i = 1 ; ok && i < n ; i++)
+		ok = (buf.id[i - 1] < buf.id[i]);
+	if (ok && n > 0)
+		ok = (buf.id.back() < next_id);
+	// types were read as raw bytes, which a bool may not hold
+	const unsigned char* types = reinterpret_cast<const unsigned char*>(buf.type.data());
+	for (unsigned int i = 0 ; ok && i < n ; i++) {
+		ok = static_cast<unsigned int>(buf.x[i]) < static_cast<unsigned int>(w)
+				&& static_cast<unsigned int>(buf.y[i]) < static_cast<unsigned int>(h)
+				&& buf.birth[i] <= frame
+				&& buf.status[i] >= STATUS_NORMAL && buf.status[i] <= STATUS_GENERATING
+				&& types[i] <= 1
+				&& (buf.partner[i] == NO_PARTNER
+					|| (buf.partner[i] < next_id && buf.partner[i] != buf.id[i]));
+	}
+	if (!ok) {
+		in.fail();
+		resize(buf, 0);
+	}
+	resize(back(), 0);
+	stepping = false;
+	reindex();
+	return ok;
+}
@@ -0,0 +1,308 @@
+/** \file DotStore.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef DotStore_H
+#define DotStore_H
+
+#include <cstddef>
+#include <vector>
+#include "Checkpoint.h"
+#include "Dot.h"
+
+/** Double-buffered structure-of-arrays storage for the dots of a world.
+ * Every dot attribute lives in its own contiguous array, all indexed by
+ * the dot's slot. Slots are kept in ID order: new dots must have a higher
+ * ID than any dot already stored, and removing dead dots compacts the
+ * arrays without reordering them. An ID to slot index, shared by both
+ * buffers, keeps IDs stable across compactions. It groups consecutive IDs
+ * in buckets, at most about two per dot, so that its size follows the
+ * population however many IDs were issued, or however far apart.
+ *
+ * A step reads the front buffer, which holds the world as the previous
+ * step left it, and writes the back buffer, then the two are swapped.
+ * A dot keeps the same slot in both buffers. Once the buffers have grown
+ * to the size of the population, stepping allocates no memory at all.
+ *
+ * Attributes are kept as small as the simulation allows: positions are
+ * 16 bits wide (see Coord), a dot's birth frame stands for its age, and
+ * status and type take a byte each, for SLOT_BYTES per dot and buffer.
+ * IDs alone are 64 bits wide, so that they never wrap around.
+ */
+class DotStore
+{
+public:
+	/** Slot of a dot which is not in the store. */
+	static constexpr unsigned int NO_SLOT = ~0u;
+	/** Partner ID of a dot without a partner. */
+	static constexpr DotId NO_PARTNER = ~0ull;
+
+#ifdef DOTS_WIDE_COORDS
+	/** A position along X or Y. Worlds of any size in a DOTS_WIDE_COORDS
+	 * build, up to MAX_GRID wide and high otherwise. */
+	using Coord = int;
+	static constexpr int MAX_GRID = 1 << 30;
+#else
+	using Coord = unsigned short;
+	static constexpr int MAX_GRID = 1 << 16;
+#endif
+	/** Dot counter, which eat_time and generation_time must not exceed */
+	using Count = unsigned short;
+	static constexpr int MAX_COUNT = 0xffff;
+
+	/** One copy of every dot attribute. */
+	struct Buffer
+	{
+		std::vector<DotId> id;
+		std::vector<Coord> x;
+		std::vector<Coord> y;
+		/** Frame of each dot's birth, see ageOf() */
+		std::vector<unsigned int> birth;
+		/** Counter (for eating and generating) */
+		std::vector<Count> count;
+		std::vector<DotStatus> status;
+		std::vector<DotType> type;
+		/** ID of each dot's generation partner, or NO_PARTNER */
+		std::vector<DotId> partner;
+
+		unsigned int size(void) const;
+		bool empty(void) const;
+	};
+
+	/** Most bytes a dot may take in each buffer of a build with 16-bit
+	 * coordinates: 8 for its ID and 8 for its partner's, as IDs must never
+	 * wrap around, 2 for each coordinate, 4 for the birth frame, 2 for the
+	 * counter and one each for status and type. A 16-byte record would
+	 * have to drop the ID or partner column, which every step reads; "has
+	 * a partner" takes no bit of its own, being NO_PARTNER. */
+	static constexpr size_t SLOT_BUDGET = 28;
+
+	/** Bytes taken by a dot in each buffer. */
+	static constexpr size_t SLOT_BYTES = sizeof(decltype(Buffer::id)::value_type)
+			+ sizeof(decltype(Buffer::x)::value_type) + sizeof(decltype(Buffer::y)::value_type)
+			+ sizeof(decltype(Buffer::birth)::value_type) + sizeof(decltype(Buffer::count)::value_type)
+			+ sizeof(decltype(Buffer::status)::value_type) + sizeof(decltype(Buffer::type)::value_type)
+			+ sizeof(decltype(Buffer::partner)::value_type);
+
+	/** Age of a dot, once <tt>frame</tt> steps have been made: the steps
+	 * it was stepped through since its birth, save for the one it died in.
+	 */
+	static unsigned int ageOf(unsigned int birth, DotStatus status, unsigned int frame)
+	{
+		return frame - birth - (status == STATUS_DEAD ? 1 : 0);
+	}
+
+	/** Read-only view of the dot in one slot of a buffer. */
+	class DotRef
+	{
+	private:
+		const Buffer* p_buf;
+		unsigned int i;
+		unsigned int frame;
+
+	public:
+		DotRef(const Buffer& buf, unsigned int slot, unsigned int frame)
+		:	p_buf(&buf), i(slot), frame(frame) {}
+
+		unsigned int slot(void) const { return i; }
+		DotId id(void) const { return p_buf->id[i]; }
+		int x(void) const { return p_buf->x[i]; }
+		int y(void) const { return p_buf->y[i]; }
+		unsigned int age(void) const { return ageOf(p_buf->birth[i], p_buf->status[i], frame); }
+		int count(void) const { return p_buf->count[i]; }
+		DotStatus status(void) const { return p_buf->status[i]; }
+		DotType type(void) const { return p_buf->type[i]; }
+		/** \return the partner's ID, or NO_PARTNER */
+		DotId partner(void) const { return p_buf->partner[i]; }
+	};
+
+	/** Every dot of a buffer, in slot (and ID) order, without copying.
+	 * Only valid while the buffer is not written. */
+	class Range
+	{
+	public:
+		class const_iterator
+		{
+		private:
+			const Buffer* p_buf;
+			unsigned int i;
+			unsigned int frame;
+
+		public:
+			const_iterator(const Buffer& buf, unsigned int slot, unsigned int frame)
+			:	p_buf(&buf), i(slot), frame(frame) {}
+
+			DotRef operator*(void) const { return DotRef(*p_buf, i, frame); }
+			const_iterator& operator++(void) { i++; return *this; }
+			bool operator==(const const_iterator& other) const { return i == other.i; }
+			bool operator!=(const const_iterator& other) const { return i != other.i; }
+		};
+
+	private:
+		const Buffer* p_buf;
+		unsigned int frame;
+
+	public:
+		/** \param frame number of steps made, which ages are relative to */
+		Range(const Buffer& buf, unsigned int frame) : p_buf(&buf), frame(frame) {}
+
+		const_iterator begin(void) const { return const_iterator(*p_buf, 0, frame); }
+		const_iterator end(void) const { return const_iterator(*p_buf, p_buf->size(), frame); }
+		unsigned int size(void) const { return p_buf->size(); }
+		DotRef operator[](unsigned int slot) const { return DotRef(*p_buf, slot, frame); }
+		/** The underlying arrays, for loops over a single attribute. */
+		const Buffer& arrays(void) const { return *p_buf; }
+	};
+
+	/** Number of valid dot statuses, STATUS_NORMAL to STATUS_GENERATING. */
+	static constexpr unsigned int N_STATUSES = 6;
+
+	/** Number of dots of each type and status. */
+	struct Census
+	{
+		Census(void);
+
+		/** Indexed by type (DOT_BETA or not), then by status */
+		unsigned int counts[2][N_STATUSES];
+
+		unsigned int of(DotType type, DotStatus status) const;
+		unsigned int ofType(DotType type) const;
+		unsigned int ofStatus(DotStatus status) const;
+		unsigned int total(void) const;
+	};
+
+private:
+	Buffer buffers[2];
+	/** Which of the buffers is the front one */
+	unsigned int front_index;
+	/** Whether a step is under way (between beginStep and endStep) */
+	bool stepping;
+
+	/** Buckets the index may have beyond one per dot, before it is
+	 * rebuilt with wider buckets */
+	static constexpr unsigned int SPARE_BUCKETS = 64;
+
+	/** Lowest ID covered by the index */
+	DotId id_base;
+	/** Each bucket of the index covers 2^id_shift consecutive IDs */
+	unsigned int id_shift;
+	/** First slot of every bucket from id_base on, then one past the last
+	 * slot, so that the dots of bucket j are those of the slots
+	 * [firsts[j], firsts[j + 1]). At most 2 * (dots + SPARE_BUCKETS) + 1
+	 * entries, however far apart their IDs. */
+	std::vector<unsigned int> firsts;
+
+	/** Number of times the buffers had to grow */
+	unsigned long growths;
+
+	void resize(Buffer& buf, unsigned int n);
+	void push(Buffer& buf, DotId nid, int nx, int ny, DotType ntype, unsigned int nbirth);
+	/** \return the ID in a slot, of the back buffer for dots born during
+	 * the current step */
+	DotId idAt(unsigned int slot) const;
+	/** Rebuild the index from the IDs of every slot, with buckets just
+	 * wide enough for there to be no more than one per dot. */
+	void reindex(void);
+
+public:
+	DotStore(void);
+
+	/** The world as the last step left it, read-only during a step. */
+	const Buffer& front(void) const;
+	/** The world being written by the current step. */
+	Buffer& back(void);
+	const Buffer& back(void) const;
+
+	/** Number of dots in the front buffer. */
+	unsigned int size(void) const;
+	bool empty(void) const;
+
+	/** Append a new dot, in STATUS_NORMAL with no partner.
+	 * It goes to the back buffer during a step, to the front one otherwise.
+	 * \param nid the dot's ID, higher than any other in the store
+	 * \param nbirth the current frame
+	 * \return the dot's slot
+	 */
+	unsigned int add(DotId nid, int nx, int ny, DotType ntype, unsigned int nbirth);
+
+	/** Remove every dot in STATUS_DEAD from the front buffer, keeping the
+	 * others in order, in a single pass over the buffer however many dots
+	 * died. Not to be called during a step.
+	 * \return the number of dots removed
+	 */
+	unsigned int removeDead(void);
+
+	/** Start a step: the back buffer gets as many slots as the front one,
+	 * each to be filled by load() before it is written.
+	 */
+	void beginStep(void);
+
+	/** Copy a slot from the front buffer to the back one. */
+	void load(unsigned int slot);
+
+	/** End a step, making the back buffer the front one. */
+	void endStep(void);
+
+	/** \return the slot of the dot with the given ID, or NO_SLOT */
+	unsigned int slotOf(DotId nid) const;
+
+	/** Every dot of the front buffer, see Range.
+	 * \param frame number of steps made */
+	Range range(unsigned int frame) const;
+
+	/** Count the dots of the front buffer by type and status, in a single
+	 * pass over those two arrays. */
+	Census census(void) const;
+
+	/** Build a stand-alone Dot with the attributes in a front slot.
+	 * \param frame number of steps made */
+	Dot view(unsigned int slot, unsigned int frame) const;
+
+	/** \return how many times the buffers had to grow so far */
+	unsigned long getGrowths(void) const;
+
+	/** \return the bytes held by both buffers and the index */
+	size_t getMemoryUsage(void) const;
+
+	/** \return the bytes held by a vector, allocated but unused ones
+	 * included */
+	template <typename T>
+	static size_t bytesOf(const std::vector<T>& v)
+	{
+		return v.capacity() * sizeof(T);
+	}
+
+	/** Add the front buffer to a checkpoint. Not to be called during
+	 * a step. */
+	void save(Checkpoint::Writer& out) const;
+	/** Replace every dot with those of a checkpoint.
+	 * \param w, h size of the world the dots must lie in
+	 * \param next_id ID the next dot will get, above every stored one
+	 * \param frame number of steps made, no dot being born later
+	 * \return false if they could not be read, are not in ID order, or
+	 * any of their attributes is out of its range
+	 */
+	bool restore(Checkpoint::Reader& in, int w, int h, DotId next_id, unsigned int frame);
+};
+
+#endif
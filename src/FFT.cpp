@@ -0,0 +1,193 @@
+/** \file FFT.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class FFT
+#include "FFT.h"
+#include "GaussFunc.h"
+#include <cmath>
+
+using namespace std;
+
+FFT::FFT(int n)
+:	n(n),
+	factors(),
+	twiddles(),
+	scratch(n),
+	chirp(),
+	filter_hat(),
+	p_conv(),
+	conv_buf()
+{
+	// split n into prime radices, bailing out on a large one
+	int rest = n;
+	bool smooth = true;
+	for (int p = 2 ; rest > 1 ; ) {
+		if (rest % p == 0) {
+			rest /= p;
+			factors.push_back(Factor { p, rest });
+		} else if (p * p > rest) {
+			p = rest;
+		} else {
+			p = (p == 2) ? 3 : p + 2;
+		}
+		if (p > MAX_RADIX) {
+			smooth = false;
+			break;
+		}
+	}
+
+	if (smooth) {
+		twiddles.resize(n);
+		for (int k = 0 ; k < n ; k++)
+			twiddles[k] = polar(1.0, -2 * (double)GaussFunc::PI * k / n);
+		return;
+	}
+
+	// Bluestein: a DFT of any size as a convolution of power-of-2 size
+	factors.clear();
+	int m = 1;
+	while (m < 2 * n - 1)
+		m <<= 1;
+
+	chirp.resize(n);
+	for (int k = 0 ; k < n ; k++) {
+		// k^2 mod 2n keeps the angle small and accurate
+		long long k2 = (long long)k * k % (2LL * n);
+		chirp[k] = polar(1.0, -(double)GaussFunc::PI * k2 / n);
+	}
+
+	p_conv.reset(new FFT(m));
+	filter_hat.assign(m, Complex(0, 0));
+	filter_hat[0] = conj(chirp[0]);
+	for (int k = 1 ; k < n ; k++) {
+		filter_hat[k] = conj(chirp[k]);
+		filter_hat[m - k] = conj(chirp[k]);
+	}
+	p_conv->transform(filter_hat.data());
+	conv_buf.resize(m);
+}
+
+int FFT::getSize(void) const
+{
+	return this->n;
+}
+
+void FFT::transform(Complex* data, bool inverse) const
+{
+	if (n <= 1)
+		return;
+
+	// the inverse transform is the conjugate of the forward one
+	if (inverse) {
+		for (int i = 0 ; i < n ; i++)
+			data[i] = conj(data[i]);
+	}
+
+	if (p_conv)
+		forwardBluestein(data);
+	else
+		forwardMixed(data);
+
+	if (inverse) {
+		for (int i = 0 ; i < n ; i++)
+			data[i] = conj(data[i]);
+	}
+}
+
+void FFT::forwardMixed(Complex* data) const
+{
+	copy(data, data + n, scratch.begin());
+	work(data, scratch.data(), 1, 0);
+}
+
+void FFT::forwardBluestein(Complex* data) const
+{
+	const int m = p_conv->getSize();
+
+	for (int k = 0 ; k < n ; k++)
+		conv_buf[k] = data[k] * chirp[k];
+	fill(conv_buf.begin() + n, conv_buf.end(), Complex(0, 0));
+
+	p_conv->transform(conv_buf.data());
+	for (int k = 0 ; k < m ; k++)
+		conv_buf[k] *= filter_hat[k];
+	p_conv->transform(conv_buf.data(), true);
+
+	for (int k = 0 ; k < n ; k++)
+		data[k] = chirp[k] * conv_buf[k] / (double)m;
+}
+
+void FFT::work(Complex* out, const Complex* in, int fstride, int k) const
+{
+	const int p = factors[k].radix;
+	const int m = factors[k].m;
+
+	// decimation in time: transform each of the p interleaved
+	// subsequences, then combine them
+	if (m == 1) {
+		for (int j = 0 ; j < p ; j++)
+			out[j] = in[j * fstride];
+	} else {
+		for (int j = 0 ; j < p ; j++)
+			work(out + j * m, in + j * fstride, fstride * p, k + 1);
+	}
+
+	if (p == 2)
+		butterfly2(out, fstride, m);
+	else
+		butterflyGeneric(out, fstride, m, p);
+}
+
+void FFT::butterfly2(Complex* out, int fstride, int m) const
+{
+	Complex* out2 = out + m;
+	for (int u = 0 ; u < m ; u++) {
+		Complex t = out2[u] * twiddles[u * fstride];
+		out2[u] = out[u] - t;
+		out[u] += t;
+	}
+}
+
+void FFT::butterflyGeneric(Complex* out, int fstride, int m, int p) const
+{
+	Complex tmp[MAX_RADIX];
+
+	for (int u = 0 ; u < m ; u++) {
+		for (int q = 0 ; q < p ; q++)
+			tmp[q] = out[u + q * m];
+
+		for (int q1 = 0 ; q1 < p ; q1++) {
+			const int k = u + q1 * m;
+			Complex acc = tmp[0];
+			int twidx = 0;
+			for (int q = 1 ; q < p ; q++) {
+				twidx += fstride * k;
+				if (twidx >= n)
+					twidx %= n;
+				acc += tmp[q] * twiddles[twidx];
+			}
+			out[k] = acc;
+		}
+	}
+}
@@ -0,0 +1,85 @@
+/** \file FFT.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+/** Complex discrete Fourier transform of a fixed size.
+ * Sizes made of small prime factors use a mixed-radix Cooley-Tukey
+ * decomposition, any other size goes through Bluestein's algorithm.
+ * Transforms are unnormalized: an inverse after a forward transform
+ * scales the data by the transform size.
+ */
+class FFT
+{
+public:
+	using Complex = std::complex<double>;
+
+private:
+	struct Factor
+	{
+		int radix;
+		int m;
+	};
+
+	int n;
+	std::vector<Factor> factors;
+	/** e^(-2 pi i k / n) */
+	std::vector<Complex> twiddles;
+	mutable std::vector<Complex> scratch;
+
+	/** Bluestein: chirp, transformed filter and a power-of-2 plan. */
+	std::vector<Complex> chirp;
+	std::vector<Complex> filter_hat;
+	std::unique_ptr<FFT> p_conv;
+	mutable std::vector<Complex> conv_buf;
+
+	void work(Complex* out, const Complex* in, int fstride, int k) const;
+	void butterfly2(Complex* out, int fstride, int m) const;
+	void butterflyGeneric(Complex* out, int fstride, int m, int p) const;
+	void forwardMixed(Complex* data) const;
+	void forwardBluestein(Complex* data) const;
+
+public:
+	/** Largest prime factor handled by the mixed-radix path. */
+	static constexpr int MAX_RADIX = 31;
+
+	explicit FFT(int n);
+	FFT(const FFT& other) = delete;
+	FFT& operator=(const FFT& other) = delete;
+
+	int getSize(void) const;
+
+	/** Transform <tt>n</tt> values in place.
+	 * \param data the values, overwritten with the transform
+	 * \param inverse whether to apply the inverse (conjugate) transform
+	 */
+	void transform(Complex* data, bool inverse = false) const;
+};
+
+#endif
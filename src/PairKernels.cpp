@@ -0,0 +1,363 @@
+/** \file PairKernels.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//namespace PairKernels
+#include "PairKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PAIRKERNELS_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using PairKernels::Isa;
+using PairKernels::LANES;
+
+namespace
+{
+	/** Positions per tile in sumAll (16 KiB of coordinates). */
+	constexpr unsigned int TILE = 2048;
+
+	Isa selected_isa = PairKernels::bestIsa();
+
+	/** Scalar accumulation of positions [j0,j1), the reference for
+	 * every vector path: same operations, lane by lane. */
+	template<typename T>
+	void accScalar(T qx, T qy, const int* xs, const int* ys,
+			unsigned int j0, unsigned int j1, unsigned int skip, T w, T h, T* acc)
+	{
+		for (unsigned int j = j0 ; j < j1 ; j++) {
+			if (j == skip)
+				continue;
+			T dx = fabs(qx - (T)xs[j]);
+			dx = min(dx, w - dx);
+			T dy = fabs(qy - (T)ys[j]);
+			dy = min(dy, h - dy);
+			acc[j % LANES] += T(1) / (dx*dx + dy*dy);
+		}
+	}
+
+	template<typename T>
+	T reduce(const T* acc)
+	{
+		return ((acc[0] + acc[1]) + (acc[2] + acc[3]))
+			+ ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+	}
+
+#ifdef PAIRKERNELS_X86
+	// Vector paths: whole blocks of LANES positions in [j0,j1)
+
+	__attribute__((target("sse2")))
+	void blocksSSE2(double qx, double qy, const int* xs, const int* ys,
+			unsigned int j0, unsigned int j1, double w, double h, double* acc)
+	{
+		const __m128d vqx = _mm_set1_pd(qx), vqy = _mm_set1_pd(qy);
+		const __m128d vw = _mm_set1_pd(w), vh = _mm_set1_pd(h);
+		const __m128d one = _mm_set1_pd(1.0);
+		const __m128d absmask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+
+		__m128d a[4];
+		for (int k = 0 ; k < 4 ; k++)
+			a[k] = _mm_loadu_pd(acc + 2*k);
+
+		for (unsigned int j = j0 ; j < j1 ; j += LANES) {
+			for (int k = 0 ; k < 4 ; k++) {
+				__m128d x = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(xs + j + 2*k)));
+				__m128d y = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(ys + j + 2*k)));
+				__m128d dx = _mm_and_pd(_mm_sub_pd(vqx, x), absmask);
+				dx = _mm_min_pd(dx, _mm_sub_pd(vw, dx));
+				__m128d dy = _mm_and_pd(_mm_sub_pd(vqy, y), absmask);
+				dy = _mm_min_pd(dy, _mm_sub_pd(vh, dy));
+				__m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+				a[k] = _mm_add_pd(a[k], _mm_div_pd(one, d2));
+			}
+		}
+
+		for (int k = 0 ; k < 4 ; k++)
+			_mm_storeu_pd(acc + 2*k, a[k]);
+	}
+
+	__attribute__((target("avx2")))
+	void blocksAVX2(double qx, double qy, const int* xs, const int* ys,
+			unsigned int j0, unsigned int j1, double w, double h, double* acc)
+	{
+		const __m256d vqx = _mm256_set1_pd(qx), vqy = _mm256_set1_pd(qy);
+		const __m256d vw = _mm256_set1_pd(w), vh = _mm256_set1_pd(h);
+		const __m256d one = _mm256_set1_pd(1.0);
+		const __m256d absmask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+
+		__m256d a0 = _mm256_loadu_pd(acc), a1 = _mm256_loadu_pd(acc + 4);
+
+		for (unsigned int j = j0 ; j < j1 ; j += LANES) {
+			__m256d x0 = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(xs + j)));
+			__m256d x1 = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(xs + j + 4)));
+			__m256d y0 = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(ys + j)));
+			__m256d y1 = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(ys + j + 4)));
+
+			__m256d dx0 = _mm256_and_pd(_mm256_sub_pd(vqx, x0), absmask);
+			__m256d dx1 = _mm256_and_pd(_mm256_sub_pd(vqx, x1), absmask);
+			dx0 = _mm256_min_pd(dx0, _mm256_sub_pd(vw, dx0));
+			dx1 = _mm256_min_pd(dx1, _mm256_sub_pd(vw, dx1));
+			__m256d dy0 = _mm256_and_pd(_mm256_sub_pd(vqy, y0), absmask);
+			__m256d dy1 = _mm256_and_pd(_mm256_sub_pd(vqy, y1), absmask);
+			dy0 = _mm256_min_pd(dy0, _mm256_sub_pd(vh, dy0));
+			dy1 = _mm256_min_pd(dy1, _mm256_sub_pd(vh, dy1));
+
+			__m256d d20 = _mm256_add_pd(_mm256_mul_pd(dx0, dx0), _mm256_mul_pd(dy0, dy0));
+			__m256d d21 = _mm256_add_pd(_mm256_mul_pd(dx1, dx1), _mm256_mul_pd(dy1, dy1));
+			a0 = _mm256_add_pd(a0, _mm256_div_pd(one, d20));
+			a1 = _mm256_add_pd(a1, _mm256_div_pd(one, d21));
+		}
+
+		_mm256_storeu_pd(acc, a0);
+		_mm256_storeu_pd(acc + 4, a1);
+	}
+
+	__attribute__((target("avx512f")))
+	void blocksAVX512(double qx, double qy, const int* xs, const int* ys,
+			unsigned int j0, unsigned int j1, double w, double h, double* acc)
+	{
+		const __m512d vqx = _mm512_set1_pd(qx), vqy = _mm512_set1_pd(qy);
+		const __m512d vw = _mm512_set1_pd(w), vh = _mm512_set1_pd(h);
+		const __m512d one = _mm512_set1_pd(1.0);
+		const __m512i absmask = _mm512_set1_epi64(0x7fffffffffffffffLL);
+
+		__m512d a = _mm512_loadu_pd(acc);
+
+		// maskz forms with a full mask: the plain intrinsics trip
+		// -Wmaybe-uninitialized inside GCC 12's headers
+		for (unsigned int j = j0 ; j < j1 ; j += LANES) {
+			__m512d x = _mm512_maskz_cvtepi32_pd(0xff, _mm256_loadu_si256((const __m256i*)(xs + j)));
+			__m512d y = _mm512_maskz_cvtepi32_pd(0xff, _mm256_loadu_si256((const __m256i*)(ys + j)));
+			__m512d dx = _mm512_castsi512_pd(_mm512_and_si512(
+					_mm512_castpd_si512(_mm512_sub_pd(vqx, x)), absmask));
+			dx = _mm512_maskz_min_pd(0xff, dx, _mm512_sub_pd(vw, dx));
+			__m512d dy = _mm512_castsi512_pd(_mm512_and_si512(
+					_mm512_castpd_si512(_mm512_sub_pd(vqy, y)), absmask));
+			dy = _mm512_maskz_min_pd(0xff, dy, _mm512_sub_pd(vh, dy));
+			__m512d d2 = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+			a = _mm512_add_pd(a, _mm512_div_pd(one, d2));
+		}
+
+		_mm512_storeu_pd(acc, a);
+	}
+
+	__attribute__((target("sse2")))
+	void blocksSSE2(float qx, float qy, const int* xs, const int* ys,
+			unsigned int j0, unsigned int j1, float w, float h, float* acc)
+	{
+		const __m128 vqx = _mm_set1_ps(qx), vqy = _mm_set1_ps(qy);
+		const __m128 vw = _mm_set1_ps(w), vh = _mm_set1_ps(h);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 absmask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+		__m128 a0 = _mm_loadu_ps(acc), a1 = _mm_loadu_ps(acc + 4);
+
+		for (unsigned int j = j0 ; j < j1 ; j += LANES) {
+			__m128 x0 = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(xs + j)));
+			__m128 x1 = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(xs + j + 4)));
+			__m128 y0 = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(ys + j)));
+			__m128 y1 = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(ys + j + 4)));
+
+			__m128 dx0 = _mm_and_ps(_mm_sub_ps(vqx, x0), absmask);
+			__m128 dx1 = _mm_and_ps(_mm_sub_ps(vqx, x1), absmask);
+			dx0 = _mm_min_ps(dx0, _mm_sub_ps(vw, dx0));
+			dx1 = _mm_min_ps(dx1, _mm_sub_ps(vw, dx1));
+			__m128 dy0 = _mm_and_ps(_mm_sub_ps(vqy, y0), absmask);
+			__m128 dy1 = _mm_and_ps(_mm_sub_ps(vqy, y1), absmask);
+			dy0 = _mm_min_ps(dy0, _mm_sub_ps(vh, dy0));
+			dy1 = _mm_min_ps(dy1, _mm_sub_ps(vh, dy1));
+
+			__m128 d20 = _mm_add_ps(_mm_mul_ps(dx0, dx0), _mm_mul_ps(dy0, dy0));
+			__m128 d21 = _mm_add_ps(_mm_mul_ps(dx1, dx1), _mm_mul_ps(dy1, dy1));
+			a0 = _mm_add_ps(a0, _mm_div_ps(one, d20));
+			a1 = _mm_add_ps(a1, _mm_div_ps(one, d21));
+		}
+
+		_mm_storeu_ps(acc, a0);
+		_mm_storeu_ps(acc + 4, a1);
+	}
+
+	__attribute__((target("avx2")))
+	void blocksAVX2(float qx, float qy, const int* xs, const int* ys,
+			unsigned int j0, unsigned int j1, float w, float h, float* acc)
+	{
+		const __m256 vqx = _mm256_set1_ps(qx), vqy = _mm256_set1_ps(qy);
+		const __m256 vw = _mm256_set1_ps(w), vh = _mm256_set1_ps(h);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 absmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+		__m256 a = _mm256_loadu_ps(acc);
+
+		for (unsigned int j = j0 ; j < j1 ; j += LANES) {
+			__m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(xs + j)));
+			__m256 y = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(ys + j)));
+			__m256 dx = _mm256_and_ps(_mm256_sub_ps(vqx, x), absmask);
+			dx = _mm256_min_ps(dx, _mm256_sub_ps(vw, dx));
+			__m256 dy = _mm256_and_ps(_mm256_sub_ps(vqy, y), absmask);
+			dy = _mm256_min_ps(dy, _mm256_sub_ps(vh, dy));
+			__m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+			a = _mm256_add_ps(a, _mm256_div_ps(one, d2));
+		}
+
+		_mm256_storeu_ps(acc, a);
+	}
+
+	// 8 floats fit in an AVX2 register already
+	void blocksAVX512(float qx, float qy, const int* xs, const int* ys,
+			unsigned int j0, unsigned int j1, float w, float h, float* acc)
+	{
+		blocksAVX2(qx, qy, xs, ys, j0, j1, w, h, acc);
+	}
+#endif
+
+	template<typename T>
+	void blocks(T qx, T qy, const int* xs, const int* ys,
+			unsigned int j0, unsigned int j1, T w, T h, T* acc)
+	{
+		if (j0 >= j1)
+			return;
+
+		switch (selected_isa) {
+#ifdef PAIRKERNELS_X86
+		case Isa::ISA_AVX512:
+			blocksAVX512(qx, qy, xs, ys, j0, j1, w, h, acc);
+			return;
+		case Isa::ISA_AVX2:
+			blocksAVX2(qx, qy, xs, ys, j0, j1, w, h, acc);
+			return;
+		case Isa::ISA_SSE2:
+			blocksSSE2(qx, qy, xs, ys, j0, j1, w, h, acc);
+			return;
+#endif
+		default:
+			accScalar(qx, qy, xs, ys, j0, j1, j1, w, h, acc);
+			return;
+		}
+	}
+
+	/** Accumulate positions [j0,j1) into the lanes, j0 being a
+	 * multiple of LANES. */
+	template<typename T>
+	void accumulate(int x, int y, const int* xs, const int* ys,
+			unsigned int j0, unsigned int j1, unsigned int skip, int w, int h, T* acc)
+	{
+		const T qx = x, qy = y, tw = w, th = h;
+		const unsigned int jfull = j0 + (j1 - j0) / LANES * LANES;
+
+		// the block holding the skipped position goes the scalar way
+		if (skip >= j0 && skip < jfull) {
+			const unsigned int sb = skip - skip % LANES;
+			blocks<T>(qx, qy, xs, ys, j0, sb, tw, th, acc);
+			accScalar<T>(qx, qy, xs, ys, sb, sb + LANES, skip, tw, th, acc);
+			blocks<T>(qx, qy, xs, ys, sb + LANES, jfull, tw, th, acc);
+		} else {
+			blocks<T>(qx, qy, xs, ys, j0, jfull, tw, th, acc);
+		}
+		accScalar<T>(qx, qy, xs, ys, jfull, j1, skip, tw, th, acc);
+	}
+
+	template<typename T>
+	double sumAt(int x, int y, const int* xs, const int* ys, unsigned int n,
+			unsigned int skip, int w, int h)
+	{
+		T acc[LANES] = {};
+		accumulate<T>(x, y, xs, ys, 0, n, skip, w, h, acc);
+		return reduce(acc);
+	}
+
+	template<typename T>
+	void sumAll(const int* xs, const int* ys, unsigned int n, int w, int h, double* out)
+	{
+		// kept from call to call, so that steady sizes allocate nothing
+		static thread_local vector<T> acc;
+		acc.assign((size_t)n * LANES, T(0));
+
+		// each tile of positions is run against every query while it is
+		// still in cache; lanes see the same additions in the same order
+		for (unsigned int j0 = 0 ; j0 < n ; j0 += TILE) {
+			const unsigned int j1 = min(n, j0 + TILE);
+			for (unsigned int i = 0 ; i < n ; i++)
+				accumulate<T>(xs[i], ys[i], xs, ys, j0, j1, i, w, h, &acc[(size_t)i * LANES]);
+		}
+
+		for (unsigned int i = 0 ; i < n ; i++)
+			out[i] = reduce(&acc[(size_t)i * LANES]);
+	}
+}
+
+Isa PairKernels::bestIsa(void)
+{
+#ifdef PAIRKERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return Isa::ISA_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return Isa::ISA_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return Isa::ISA_SSE2;
+#endif
+	return Isa::ISA_SCALAR;
+}
+
+Isa PairKernels::getIsa(void)
+{
+	return selected_isa;
+}
+
+void PairKernels::setIsa(Isa isa)
+{
+	selected_isa = min(isa, bestIsa());
+}
+
+const char* PairKernels::isaName(Isa isa)
+{
+	switch (isa)
+	{
+		case Isa::ISA_SSE2: return "SSE2";
+		case Isa::ISA_AVX2: return "AVX2";
+		case Isa::ISA_AVX512: return "AVX-512";
+		default: return "scalar";
+	}
+}
+
+double PairKernels::sumAt(int x, int y, const int* xs, const int* ys, unsigned int n,
+		unsigned int skip, int w, int h, bool single)
+{
+	if (single)
+		return ::sumAt<float>(x, y, xs, ys, n, skip, w, h);
+	return ::sumAt<double>(x, y, xs, ys, n, skip, w, h);
+}
+
+void PairKernels::sumAll(const int* xs, const int* ys, unsigned int n, int w, int h,
+		double* out, bool single)
+{
+	if (single)
+		::sumAll<float>(xs, ys, n, w, h, out);
+	else
+		::sumAll<double>(xs, ys, n, w, h, out);
+}
@@ -0,0 +1,75 @@
+/** \file PairKernels.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef PairKernels_H
+#define PairKernels_H
+
+/** All-pairs kernels over packed coordinate arrays.
+ * Sums of 1/d^2 (d being the toroidal distance) are split into LANES
+ * partial sums, element j going to lane j % LANES, which are then added
+ * up in a fixed order. Every instruction set therefore adds the same
+ * numbers in the same order, and the scalar fallback gives bit-identical
+ * results to the vector paths.
+ */
+namespace PairKernels
+{
+	enum class Isa : int
+	{
+		ISA_SCALAR,
+		ISA_SSE2,
+		ISA_AVX2,
+		ISA_AVX512
+	};
+
+	constexpr unsigned int LANES = 8;
+
+	/** The best instruction set supported by this CPU. */
+	Isa bestIsa(void);
+	/** The instruction set in use, the best one by default. */
+	Isa getIsa(void);
+	/** Select an instruction set, capped to the best supported one. */
+	void setIsa(Isa isa);
+	const char* isaName(Isa isa);
+
+	/** Sum of 1/d^2 from (x,y) to every packed position but one.
+	 * \param xs
+	 * \param ys the packed positions
+	 * \param n the number of positions
+	 * \param skip index of a position to leave out, n or more for none
+	 * \param w
+	 * \param h the world size
+	 * \param single whether to do the arithmetic in single precision
+	 */
+	double sumAt(int x, int y, const int* xs, const int* ys, unsigned int n,
+			unsigned int skip, int w, int h, bool single = false);
+
+	/** sumAt for every packed position, leaving out the position itself,
+	 * in cache-sized tiles.
+	 * \param out n sums, bit-identical to n calls to sumAt
+	 */
+	void sumAll(const int* xs, const int* ys, unsigned int n, int w, int h,
+			double* out, bool single = false);
+}
+
+#endif
@@ -0,0 +1,126 @@
+/** \file PerfCounters.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class PerfCounters
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef __linux__
+	const unsigned long long EVENTS[StepProfile::N_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	int openEvent(unsigned long long config, int group)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config;
+		attr.disabled = (group < 0);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+		return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+	}
+#endif
+}
+
+PerfCounters::PerfCounters(void)
+{
+	for (int c = 0 ; c < StepProfile::N_COUNTERS ; c++)
+		fds[c] = -1;
+}
+
+PerfCounters::~PerfCounters()
+{
+	close();
+}
+
+bool PerfCounters::open(void)
+{
+	if (isOpen())
+		return true;
+#ifdef __linux__
+	// the first counter leads the group, the others follow it
+	for (int c = 0 ; c < StepProfile::N_COUNTERS ; c++) {
+		fds[c] = openEvent(EVENTS[c], fds[0]);
+		if (fds[c] < 0) {
+			close();
+			return false;
+		}
+	}
+	ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool PerfCounters::isOpen(void) const
+{
+	return fds[0] >= 0;
+}
+
+void PerfCounters::close(void)
+{
+	for (int c = StepProfile::N_COUNTERS - 1 ; c >= 0 ; c--) {
+#ifdef __linux__
+		if (fds[c] >= 0)
+			::close(fds[c]);
+#endif
+		fds[c] = -1;
+	}
+}
+
+bool PerfCounters::read(unsigned long long values[StepProfile::N_COUNTERS]) const
+{
+	if (!isOpen())
+		return false;
+#ifdef __linux__
+	// number of counters, then their values
+	unsigned long long data[1 + StepProfile::N_COUNTERS];
+	if (::read(fds[0], data, sizeof(data)) != (ssize_t)sizeof(data)
+			|| data[0] != StepProfile::N_COUNTERS)
+		return false;
+	for (int c = 0 ; c < StepProfile::N_COUNTERS ; c++)
+		values[c] = data[1 + c];
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,60 @@
+/** \file PerfCounters.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef PerfCounters_H
+#define PerfCounters_H
+
+#include "StepProfile.h"
+
+/** Hardware counters of the calling thread, read together as a group
+ * (Linux perf_event_open). Only user space is counted, which most
+ * systems allow without privileges; where they are not allowed, or
+ * elsewhere than on Linux, the group simply fails to open.
+ */
+class PerfCounters
+{
+private:
+	int fds[StepProfile::N_COUNTERS];
+
+public:
+	PerfCounters(void);
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	/** Start counting on the calling thread.
+	 * \return whether the counters are available
+	 */
+	bool open(void);
+	bool isOpen(void) const;
+	void close(void);
+
+	/** Read the counts so far, in StepProfile::Counter order.
+	 * \return false if the group is not open or could not be read
+	 */
+	bool read(unsigned long long values[StepProfile::N_COUNTERS]) const;
+};
+
+#endif
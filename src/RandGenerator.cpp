@@ -26,13 +26,87 @@
 
 //namespace RandGenerator
 #include "RandGenerator.h"
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <stdlib.h>
+
+namespace
+{
+	// Philox4x32 multipliers and Weyl key increments
+	constexpr uint64_t PHILOX_M0 = 0xD2511F53;
+	constexpr uint64_t PHILOX_M1 = 0xCD9E8D57;
+	constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+	constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+	constexpr int PHILOX_ROUNDS = 10;
+
+	/** Counters run side by side in uniforms(), lane by lane. */
+	constexpr unsigned int BLOCK = 8;
+
+	// sequences of x[n] = x[n-31] + x[n-3], seeded by a
+	// Lehmer generator and run past its first outputs
+	constexpr unsigned int SEQUENCE_WORDS = 31;
+	constexpr unsigned int SEQUENCE_SEPARATION = 3;
+	constexpr unsigned int SEQUENCE_DISCARD = 310;
+
+	RandGenerator::State seeded(unsigned int rand_seed)
+	{
+		RandGenerator::State state;
+		RandGenerator::set_seed(state, rand_seed);
+		return state;
+	}
+
+	// seeded with 1 until told otherwise, as rand() is
+	RandGenerator::State global = seeded(1);
+
+	inline double toUniform(uint32_t hi, uint32_t lo)
+	{
+		return ((hi >> 5) * 67108864.0 + (lo >> 6)) * (1.0 / 9007199254740992.0);
+	}
+}
 
 
 void RandGenerator::set_seed(unsigned int rand_seed)
 {
-	srand(rand_seed);
+	set_seed(global, rand_seed);
+}
+
+void RandGenerator::set_seed(State& state, unsigned int rand_seed)
+{
+	int32_t word = (rand_seed == 0) ? 1 : (int32_t)rand_seed;
+	state.words[0] = word;
+	for (unsigned int i = 1 ; i < SEQUENCE_WORDS ; i++) {
+		// 16807 * word % (2^31 - 1), without overflowing
+		const int32_t hi = word / 127773;
+		const int32_t lo = word % 127773;
+		word = 16807 * lo - 2836 * hi;
+		if (word < 0)
+			word += 2147483647;
+		state.words[i] = word;
+	}
+	state.front = SEQUENCE_SEPARATION;
+	state.rear = 0;
+	for (unsigned int i = 0 ; i < SEQUENCE_DISCARD ; i++)
+		integer(state);
+}
+
+bool RandGenerator::valid(const State& state)
+{
+	return state.front < SEQUENCE_WORDS && state.rear < SEQUENCE_WORDS
+			&& (state.front + SEQUENCE_WORDS - state.rear) % SEQUENCE_WORDS == SEQUENCE_SEPARATION;
+}
+
+int RandGenerator::integer(void)
+{
+	return integer(global);
+}
+
+int RandGenerator::integer(State& state)
+{
+	const uint32_t word = state.words[state.front] += state.words[state.rear];
+	state.front = (state.front + 1) % SEQUENCE_WORDS;
+	state.rear = (state.rear + 1) % SEQUENCE_WORDS;
+	return word >> 1;
 }
 
 void RandGenerator::pdf2cdf(const double* pdf, double *cdf, int n)
@@ -43,11 +117,90 @@ void RandGenerator::pdf2cdf(const double* pdf, double *cdf, int n)
 	assert (cdf[n-1] = 1);
 }
 
-int RandGenerator::genvar(const double* cdf)
+int RandGenerator::genvar(const double* cdf, int n)
+{
+	return genvar(cdf, n, uniform());
+}
+
+double RandGenerator::uniform(void)
+{
+	return uniform(global);
+}
+
+double RandGenerator::uniform(State& state)
+{
+	return (double)integer(state) / INTEGER_MAX;
+}
+
+void RandGenerator::philox(const unsigned int ctr[4], const unsigned int key[2], unsigned int out[4])
+{
+	uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+	uint32_t k0 = key[0], k1 = key[1];
+
+	for (int r = 0 ; r < PHILOX_ROUNDS ; r++) {
+		const uint64_t p0 = PHILOX_M0 * c0;
+		const uint64_t p1 = PHILOX_M1 * c2;
+		c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c1 = (uint32_t)p1;
+		c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c3 = (uint32_t)p0;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+double RandGenerator::uniform(unsigned int seed, unsigned int frame, unsigned long long id, unsigned int draw)
+{
+	// IDs below 2^32 leave the second word 0
+	const unsigned int ctr[4] = { (unsigned int)id, (unsigned int)(id >> 32), frame, draw };
+	const unsigned int key[2] = { seed, 0 };
+	unsigned int out[4];
+	philox(ctr, key, out);
+	return toUniform(out[0], out[1]);
+}
+
+void RandGenerator::uniforms(unsigned int seed, unsigned int frame, const unsigned long long* ids,
+		unsigned int n, unsigned int ndraws, double* out)
+{
+	// same rounds as philox(), over a block of counters at once,
+	// which the compiler turns into vector multiplies
+	for (unsigned int j0 = 0 ; j0 < n ; j0 += BLOCK) {
+		const unsigned int m = std::min(BLOCK, n - j0);
+		for (unsigned int k = 0 ; k < ndraws ; k++) {
+			uint32_t c0[BLOCK], c1[BLOCK], c2[BLOCK], c3[BLOCK];
+			for (unsigned int b = 0 ; b < BLOCK ; b++) {
+				c0[b] = (b < m) ? (uint32_t)ids[j0 + b] : 0;
+				c1[b] = (b < m) ? (uint32_t)(ids[j0 + b] >> 32) : 0;
+				c2[b] = frame;
+				c3[b] = k;
+			}
+
+			uint32_t k0 = seed, k1 = 0;
+			for (int r = 0 ; r < PHILOX_ROUNDS ; r++) {
+				for (unsigned int b = 0 ; b < BLOCK ; b++) {
+					const uint64_t p0 = PHILOX_M0 * c0[b];
+					const uint64_t p1 = PHILOX_M1 * c2[b];
+					c0[b] = (uint32_t)(p1 >> 32) ^ c1[b] ^ k0;
+					c1[b] = (uint32_t)p1;
+					c2[b] = (uint32_t)(p0 >> 32) ^ c3[b] ^ k1;
+					c3[b] = (uint32_t)p0;
+				}
+				k0 += PHILOX_W0;
+				k1 += PHILOX_W1;
+			}
+
+			for (unsigned int b = 0 ; b < m ; b++)
+				out[(size_t)(j0 + b) * ndraws + k] = toUniform(c0[b], c1[b]);
+		}
+	}
+}
+
+int RandGenerator::genvar(const double* cdf, int n, double u)
 {
-	double u = (double)rand() / RAND_MAX;
 	int i = 0;
-	while (cdf[i] < u)
+	while (i < n - 1 && cdf[i] < u)
 	{
 		i++;
 	}
@@ -27,10 +27,55 @@
 
 namespace RandGenerator
 {
+	/** State of a sequence, which may be saved and restored. Sequences
+	 * are those of the additive feedback generator behind glibc's rand(),
+	 * each with a state of its own. Functions without a state use the
+	 * global sequence. */
+	struct State
+	{
+		unsigned int words[31];
+		unsigned int front;
+		unsigned int rear;
+	};
+
+	/** Largest value of integer(), as glibc's RAND_MAX. */
+	constexpr int INTEGER_MAX = 2147483647;
+
 	void set_seed(unsigned int rand_seed);
+	void set_seed(State& state, unsigned int rand_seed);
+	/** \return whether a sequence can be in the state, which may come
+	 * from a file */
+	bool valid(const State& state);
 
 	void pdf2cdf(const double* pdf, double* cdf, int n);
-	int genvar(const double* cdf);
+	int genvar(const double* cdf, int n);
+	/** Pick one of n variables from a cdf with a given uniform draw in
+	 * [0,1]. Should rounding leave cdf[n-1] under the draw, the last
+	 * variable is picked. */
+	int genvar(const double* cdf, int n, double u);
+	/** Draw from the global sequence, uniform in [0,1]. */
+	double uniform(void);
+	double uniform(State& state);
+	/** Draw from the global sequence, in [0, INTEGER_MAX]. */
+	int integer(void);
+	int integer(State& state);
+
+	/** Philox4x32-10 block: a counter-based generator, every output
+	 * being a pure function of its counter and key.
+	 */
+	void philox(const unsigned int ctr[4], const unsigned int key[2], unsigned int out[4]);
+
+	/** Counter-based draw, uniform in [0,1) with 53 random bits.
+	 * Draws of any (seed, frame, id, draw) may be made in any order,
+	 * from any thread, and always give the same value.
+	 */
+	double uniform(unsigned int seed, unsigned int frame, unsigned long long id, unsigned int draw);
+
+	/** Fill out[j * ndraws + k] with uniform(seed, frame, ids[j], k) for
+	 * every j < n and k < ndraws, several counters at a time.
+	 */
+	void uniforms(unsigned int seed, unsigned int frame, const unsigned long long* ids,
+			unsigned int n, unsigned int ndraws, double* out);
 };
 
 #endif
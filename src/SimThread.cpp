@@ -0,0 +1,155 @@
+/** \file SimThread.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class SimThread
+#include "SimThread.h"
+#include <chrono>
+
+using namespace std;
+
+/** Longest sleep between checks for commands */
+static constexpr chrono::milliseconds POLL_PERIOD(5);
+
+SimThread::Snapshot::Snapshot(void)
+:	frame(0),
+	ndots(0),
+	deaths(0),
+	death_average(0),
+	max_age(0),
+	max_dots(0),
+	census(),
+	x(),
+	y(),
+	status(),
+	type()
+{
+}
+
+unsigned int SimThread::Snapshot::size(void) const
+{
+	return x.size();
+}
+
+SimThread::SimThread(Simulator& sim, int speed)
+:	sim(sim),
+	snapshots(),
+	thread(),
+	quitting(false),
+	paused(false),
+	speed(speed)
+{
+}
+
+SimThread::~SimThread()
+{
+	stop();
+}
+
+void SimThread::start(void)
+{
+	if (thread.joinable())
+		return;
+	publish();
+	quitting = false;
+	thread = std::thread(&SimThread::run, this);
+}
+
+void SimThread::stop(void)
+{
+	quitting = true;
+	if (thread.joinable())
+		thread.join();
+}
+
+void SimThread::setPaused(bool pause)
+{
+	paused = pause;
+}
+
+void SimThread::setSpeed(int speed)
+{
+	this->speed = speed;
+}
+
+bool SimThread::update(void)
+{
+	return snapshots.update();
+}
+
+const SimThread::Snapshot& SimThread::snapshot(void) const
+{
+	return snapshots.readSlot();
+}
+
+void SimThread::publish(void)
+{
+	Snapshot& shot = snapshots.writeSlot();
+	shot.frame = sim.getFrame();
+	shot.ndots = sim.ndots();
+	shot.deaths = sim.getNDeaths();
+	shot.death_average = sim.getDeathAverage();
+	shot.max_age = sim.getMaxAge();
+	shot.max_dots = sim.getMaxDots();
+	shot.census = sim.getCensus();
+
+	// same storage every third step, so copies allocate no memory
+	// once the population stops growing
+	const DotStore::Buffer& dots = sim.view().arrays();
+	shot.x.assign(dots.x.begin(), dots.x.end());
+	shot.y.assign(dots.y.begin(), dots.y.end());
+	shot.status.assign(dots.status.begin(), dots.status.end());
+	shot.type.assign(dots.type.begin(), dots.type.end());
+
+	snapshots.publish();
+}
+
+void SimThread::run(void)
+{
+	using clock = chrono::steady_clock;
+	clock::time_point next = clock::now();
+
+	while (!quitting) {
+		const clock::time_point now = clock::now();
+		if (paused || sim.ndots() == 0) {
+			this_thread::sleep_for(POLL_PERIOD);
+			next = now;
+			continue;
+		}
+
+		const int steps = speed;
+		if (steps > 0) {
+			if (now < next) {
+				this_thread::sleep_until(min(next, now + POLL_PERIOD));
+				continue;
+			}
+			// steps missed by a slow step are not made up for
+			const clock::duration period = chrono::duration_cast<clock::duration>(
+					chrono::duration<double>(1.0 / steps));
+			next = max(next + period, now);
+		}
+
+		sim.step();
+		publish();
+	}
+}
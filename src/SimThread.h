@@ -0,0 +1,107 @@
+/** \file SimThread.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SimThread_H
+#define SimThread_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "Dot.h"
+#include "Simulator.h"
+#include "TripleBuffer.h"
+
+/** Steps a simulator on a thread of its own, so that drawing and stepping
+ * do not hold each other back. After every step the dots and statistics
+ * are copied into a snapshot, handed to the display through a triple
+ * buffer: the display always takes the latest snapshot without waiting,
+ * and the simulation never waits for the display. Commands (pause, speed)
+ * are atomic flags which the thread checks between steps.
+ *
+ * Once started, the simulator belongs to the thread until stop().
+ */
+class SimThread
+{
+public:
+	/** The world after a step, compact enough to copy every step. */
+	struct Snapshot
+	{
+		Snapshot(void);
+
+		unsigned int frame;
+		unsigned int ndots;
+		double deaths;
+		double death_average;
+		unsigned int max_age;
+		unsigned int max_dots;
+		DotStore::Census census;
+
+		std::vector<DotStore::Coord> x;
+		std::vector<DotStore::Coord> y;
+		std::vector<DotStatus> status;
+		std::vector<DotType> type;
+
+		unsigned int size(void) const;
+	};
+
+private:
+	Simulator& sim;
+	TripleBuffer<Snapshot> snapshots;
+	std::thread thread;
+
+	std::atomic<bool> quitting;
+	std::atomic<bool> paused;
+	/** Steps per second, 0 for as many as possible */
+	std::atomic<int> speed;
+
+	void run(void);
+	void publish(void);
+
+public:
+	/** \param speed steps per second, 0 for no limit */
+	SimThread(Simulator& sim, int speed);
+	~SimThread();
+
+	SimThread(const SimThread&) = delete;
+	SimThread& operator=(const SimThread&) = delete;
+
+	/** Publish the current state and start stepping. */
+	void start(void);
+	/** Stop stepping, after the step under way if any, and wait for the
+	 * thread to end. */
+	void stop(void);
+
+	void setPaused(bool pause);
+	/** \param speed steps per second, 0 for no limit */
+	void setSpeed(int speed);
+
+	/** Take the latest snapshot, if one was published since the last call.
+	 * \return whether snapshot() changed
+	 */
+	bool update(void);
+	/** The snapshot taken by the last update(), valid until the next. */
+	const Snapshot& snapshot(void) const;
+};
+
+#endif
@@ -24,130 +24,521 @@
  */
 //Class Simulator
 #include "Simulator.h"
+#include "PairKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
 
 using namespace std;
 
+// Profiling hooks, which DOTS_NO_PROFILE compiles out. Phases and lookup
+// times are only measured while profiling, lookups are always counted.
+#ifdef DOTS_NO_PROFILE
+#define PROFILE_PHASE(phase)
+#define PROFILE_COUNT(count)
+#define PROFILE_LOOKUP(count, seconds)
+#else
+#define PROFILE_PHASE(phase) \
+	do { if (dconfig.profile) profilePhase(phase); } while (0)
+#define PROFILE_COUNT(count) ((count)++)
+#define PROFILE_LOOKUP(count, seconds) \
+	StepProfile::Stopwatch lookup_watch((count), dconfig.profile ? &(seconds) : nullptr)
+#endif
+
+namespace
+{
+	constexpr int phaseIndex(StepProfile::Phase phase)
+	{
+		return static_cast<int>(phase);
+	}
+
+	/** Every DotConf field kept in checkpoints, in file order, for a
+	 * Checkpoint::Writer or Reader; look_prob is computed from them. */
+	template<typename Archive, typename Conf>
+	void confFields(Archive& archive, Conf& conf)
+	{
+		archive.value(conf.hunger_chance);
+		archive.value(conf.dot_density);
+		archive.value(conf.death_chance_maj);
+		archive.value(conf.looking_chance_mean);
+		archive.value(conf.looking_chance_var);
+		archive.value(conf.looking_chance_p);
+		archive.value(conf.eat_time);
+		archive.value(conf.generation_time);
+		archive.value(conf.density_mode);
+		archive.value(conf.density_rebuild_period);
+		archive.value(conf.density_theta);
+		archive.value(conf.density_single);
+		archive.value(conf.step_mode);
+		archive.value(conf.step_threads);
+		archive.value(conf.rng_mode);
+		archive.value(conf.schedule_mode);
+		archive.value(conf.nearest_check);
+		archive.value(conf.profile);
+		archive.value(conf.profile_period);
+	}
+
+	/** \return whether a bool read from a checkpoint's raw bytes holds
+	 * false or true */
+	bool validBool(const bool& value)
+	{
+		unsigned char byte;
+		memcpy(&byte, &value, sizeof(byte));
+		return byte <= 1;
+	}
+}
+
+constexpr unsigned char Simulator::DUE_NONE;
+constexpr unsigned char Simulator::DUE_DEATH;
+constexpr unsigned char Simulator::DUE_END;
+
 Simulator::Simulator(unsigned int rseed, const DotConf& dotconfig, int nw = 64, int nh = 64)
 :	dots(),
     grid_w(nw),
 	grid_h(nh),
 	n_frame(0),
+	rng_seed(rseed),
+	rng(),
+	next_id(0),
 	stat_age_total(0),
 	stat_deaths_total(0),
 	stat_max_age(0),
 	stat_max_dots(0),
-	dconfig(dotconfig)
+	dconfig(dotconfig),
+	grid(),
+	density(),
+	density_tree(),
+	snap_density(),
+	snap_x(),
+	snap_y(),
+	schedule(),
+	due(),
+	deaths_by_frame(),
+	dying(),
+	p_pool(),
+	phase_first(0),
+	draws(),
+	old_x(),
+	old_y(),
+	old_status(),
+	birth_x(),
+	birth_y(),
+	born(),
+	profile(),
+	perf(),
+	perf_tried(false),
+	profile_phase(-1),
+	phase_start(),
+	phase_counters(),
+	profile_lock(),
+	nearest_mismatches(0)
 {
-	RandGenerator::set_seed(rseed);
+	RandGenerator::set_seed(rng, rseed);
+
+	if (dconfig.density_mode == DensityMode::DENSITY_FFT
+			|| dconfig.density_mode == DensityMode::DENSITY_INCREMENTAL)
+		density.reset(grid_w, grid_h);
+	else if (dconfig.density_mode == DensityMode::DENSITY_TREE)
+		density_tree.reset(grid_w, grid_h, dconfig.density_theta);
+
+	if (dconfig.step_mode == StepMode::STEP_PARALLEL)
+		p_pool.reset(new ThreadPool(dconfig.step_threads));
+
+	// the longest lifetime is that of a dot living to the end of the table
+	if (dconfig.schedule_mode == ScheduleMode::SCHEDULE_LIFETIMES)
+		deaths_by_frame.reset(dconfig.transitions.size());
 }
 
 Simulator::~Simulator()
 {
 }
 
-unsigned int Simulator::addDot(int x, int y, DotType type)
+DotId Simulator::addDot(int x, int y, DotType type)
 {
-	Dot d = Dot::create(x, y, type, dconfig);
-	auto id = d.getID();
-	dots[id] = d;
+	auto id = next_id++;
+	dots.add(id, x, y, type, n_frame);
+	if (dconfig.density_mode == DensityMode::DENSITY_INCREMENTAL)
+		density.add(x, y);
+	if (dconfig.schedule_mode == ScheduleMode::SCHEDULE_LIFETIMES) {
+		// a dot's first step is the one it is born in, or the next one for
+		// those added between steps; none can die at age 0, which leaves
+		// the current frame's deaths, already taken, alone
+		const double u = 1 - RandGenerator::uniform(rng_seed, n_frame, id, DRAW_LIFETIME);
+		const unsigned int lifetime = max(1u, dconfig.transitions.deathAge(0, u));
+		deaths_by_frame.add(n_frame + lifetime, id);
+	}
 	return id;
 }
 
-unsigned int Simulator::addRDot()
+DotId Simulator::addRDot()
 {
-	int x = rand() % grid_w;
-	int y = rand() % grid_h;
+	int x = RandGenerator::integer(rng) % grid_w;
+	int y = RandGenerator::integer(rng) % grid_h;
 	return addRDot(x,y);
 }
 
-unsigned int Simulator::addRDot(int x, int y)
+DotId Simulator::addRDot(int x, int y)
 {
-	int st = (rand() & 1);
+	int st = (RandGenerator::integer(rng) & 1);
     return addDot(x, y, (st==0) ? DotType::DOT_ALPHA : DotType::DOT_BETA);
 }
 
 void Simulator::step()
 {
+#ifndef DOTS_NO_PROFILE
+    if (dconfig.profile && !perf_tried) {
+        perf_tried = true;
+        profile.has_counters = perf.open();
+    }
+#endif
+    StepProfile::Counts counts;
+    PROFILE_PHASE(phaseIndex(StepProfile::Phase::PHASE_PRUNE));
+
     // Pre-filter dead dots
-	for(auto it = begin(dots) ; it != end(dots) ; ) {
-
-		// If status = STATUS_DEAD, remove dot from the list
-		if (it->second.getStatus() == STATUS_DEAD) {
-			dots.erase(it);
-			it = begin(dots);
-		} else
-            ++it;
-	}
-
-    // take a copy of the current status (everything is copy constructed)
-    auto dots_copy = dots;
-    set<unsigned int> generated;
-
-    auto deaths = 0u;
-	for(auto it = begin(dots) ; it != end(dots) ; ++it) {
-//	    const unsigned int id = it->first;
-        Dot& dot = it->second;
-
-		this->stepDot(dot, dots_copy, generated);
-
-		if (dot.getStatus() == STATUS_DEAD)
-		{
-			this->stat_age_total += dot.getAge();
-			this->stat_deaths_total += 1;
-			deaths++;
-		}
-
-	}
+    if (dconfig.density_mode == DensityMode::DENSITY_INCREMENTAL) {
+        const DotStore::Buffer& front = dots.front();
+        for (unsigned int i = 0 ; i < front.size() ; i++) {
+            if (front.status[i] == STATUS_DEAD)
+                density.remove(front.x[i], front.y[i]);
+        }
+    }
+    dots.removeDead();
+
+    // the front buffer keeps the previous frame, the back one is written
+    const DotStore::Buffer& front = dots.front();
+    DotStore::Buffer& back = dots.back();
+    PROFILE_PHASE(phaseIndex(StepProfile::Phase::PHASE_INDEX));
+    dots.beginStep();
+    if (dconfig.schedule_mode == ScheduleMode::SCHEDULE_EVENTS)
+        takeDueEvents();
+    else if (dconfig.schedule_mode == ScheduleMode::SCHEDULE_LIFETIMES)
+        takeDueDeaths();
+
+    grid.rebuild(front, grid_w, grid_h);
+    PROFILE_PHASE(phaseIndex(StepProfile::Phase::PHASE_DENSITY));
+    if (dconfig.density_mode == DensityMode::DENSITY_DIRECT) {
+        const unsigned int n = front.size();
+        snap_x.assign(front.x.begin(), front.x.end());
+        snap_y.assign(front.y.begin(), front.y.end());
+        // only the dots whose status reads it need their sum: one pass
+        // each, unless most of them do and the tiled sums of every dot
+        // come cheaper
+        unsigned int readers = 0;
+        for (unsigned int i = 0 ; i < n ; i++)
+            readers += TransitionTable::readsDensity(front.status[i]);
+        if (readers * 2 > n) {
+            snap_density.resize(n);
+            PairKernels::sumAll(snap_x.data(), snap_y.data(), n,
+                    grid_w, grid_h, snap_density.data(), dconfig.density_single);
+        } else
+            snap_density.clear();
+    } else if (dconfig.density_mode == DensityMode::DENSITY_FFT) {
+        density.rebuild(front);
+    } else if (dconfig.density_mode == DensityMode::DENSITY_INCREMENTAL) {
+        // bring the field up to date with the snapshot
+        const int period = dconfig.density_rebuild_period;
+        density.commit(period > 0 && n_frame % period == 0);
+    } else if (dconfig.density_mode == DensityMode::DENSITY_TREE) {
+        density_tree.rebuild(front);
+    }
+
+    PROFILE_PHASE(phaseIndex(StepProfile::Phase::PHASE_DOTS));
+    auto deaths = 0u;
+    const unsigned long long mismatches = nearest_mismatches;
+    if (dconfig.step_mode == StepMode::STEP_PARALLEL) {
+        stepParallel(deaths, counts);
+    } else {
+        if (dconfig.rng_mode == RngMode::RNG_COUNTER) {
+            // the whole snapshot's draws in one pass, newborns draw their own
+            phase_first = 0;
+            draws.resize((size_t)front.size() * DRAWS_PER_DOT);
+            RandGenerator::uniforms(rng_seed, n_frame, front.id.data(), front.size(),
+                    DRAWS_PER_DOT, draws.data());
+        }
+        // dots born in this step are appended, and stepped as well
+        for(unsigned int i = 0 ; i < back.size() ; i++) {
+            if (i < front.size())
+                dots.load(i);
+            const int ox = back.x[i], oy = back.y[i];
+            const DotStatus os = back.status[i];
+
+            this->stepDot(i, counts);
+            this->finishDot(i, ox, oy, os, deaths);
+        }
+    }
+    if (nearest_mismatches != mismatches) {
+        cerr << "frame " << n_frame << ": " << (nearest_mismatches - mismatches)
+                << " nearest dot queries differ from a full scan" << endl;
+    }
+    PROFILE_PHASE(phaseIndex(StepProfile::Phase::PHASE_SWAP));
+    dots.endStep();
+
     auto living_dots = dots.size()-deaths;
 	if (stat_max_dots < living_dots)
 		stat_max_dots = living_dots;
-
+
 	this->n_frame++;
-}
 
-void Simulator::stepDot(Dot& dot, const DotMap& dots_copy, set<unsigned int>& generated)
+#ifndef DOTS_NO_PROFILE
+	if (dconfig.profile) {
+		profilePhase(-1);
+		counts.deaths = deaths;
+		profile.counts += counts;
+		profile.steps++;
+		if (dconfig.profile_period > 0 && n_frame % dconfig.profile_period == 0)
+			profile.dump(cerr, n_frame);
+	}
+#endif
+}
+
+void Simulator::profilePhase(int next)
 {
-    auto& cdot = dot;
-//    const auto& cdot_prev = (dots_copy.find(dot.getID()) != end(dots_copy))
-//            ? dots_copy[dot.getID()] : dot;
+	const auto now = chrono::steady_clock::now();
+	unsigned long long values[StepProfile::N_COUNTERS];
+	const bool counted = perf.read(values);
+
+	if (profile_phase >= 0) {
+		profile.seconds[profile_phase] += chrono::duration<double>(now - phase_start).count();
+		for (int c = 0 ; counted && c < StepProfile::N_COUNTERS ; c++)
+			profile.counters[profile_phase][c] += values[c] - phase_counters[c];
+	}
+
+	profile_phase = next;
+	phase_start = now;
+	for (int c = 0 ; counted && c < StepProfile::N_COUNTERS ; c++)
+		phase_counters[c] = values[c];
+}
 
+void Simulator::stepParallel(unsigned int& deaths, StepProfile::Counts& counts)
+{
+    DotStore::Buffer& back = dots.back();
+
+    // dots born in a phase are stepped in the next one
+    for (unsigned int first = 0 ; first < back.size() ; ) {
+        const unsigned int last = back.size();
+        const unsigned int n = last - first;
+
+        // draws are made up front, whichever thread uses them
+        phase_first = first;
+        draws.resize((size_t)n * DRAWS_PER_DOT);
+        if (dconfig.rng_mode == RngMode::RNG_COUNTER) {
+            // the first phase is the snapshot, not loaded into the back buffer yet
+            const DotStore::Buffer& ids = (first < dots.size()) ? dots.front() : back;
+            RandGenerator::uniforms(rng_seed, n_frame, ids.id.data() + first, n,
+                    DRAWS_PER_DOT, draws.data());
+        } else {
+            // handed out in slot order
+            for (double& u : draws)
+                u = RandGenerator::uniform(rng);
+        }
+        old_x.resize(n);
+        old_y.resize(n);
+        old_status.resize(n);
+        birth_x.resize(n);
+        birth_y.resize(n);
+        born.assign(n, 0);
+
+        p_pool->run(first, last, [this, &counts](unsigned int a, unsigned int b) {
+            this->stepRange(a, b, counts);
+        });
+
+        // births and statistics, in slot order
+        PROFILE_PHASE(phaseIndex(StepProfile::Phase::PHASE_BIRTHS));
+        for (unsigned int i = first ; i < last ; i++) {
+            const unsigned int k = i - first;
+            if (born[k]) {
+                const double u = draws[(size_t)k * DRAWS_PER_DOT + DRAW_BIRTH];
+                addDot(birth_x[k], birth_y[k], (u < 0.5) ? DotType::DOT_ALPHA : DotType::DOT_BETA);
+                PROFILE_COUNT(counts.births);
+            }
+            finishDot(i, old_x[k], old_y[k], old_status[k], deaths);
+        }
+        PROFILE_PHASE(phaseIndex(StepProfile::Phase::PHASE_DOTS));
+        first = last;
+    }
+}
+
+void Simulator::stepRange(unsigned int first, unsigned int last, StepProfile::Counts& counts)
+{
+    DotStore::Buffer& back = dots.back();
+    const unsigned int nfront = dots.size();
+
+    // counted apart, added up once the range is done
+    StepProfile::Counts range_counts;
+    for (unsigned int i = first ; i < last ; i++) {
+        if (i < nfront)
+            dots.load(i);
+        old_x[i - phase_first] = back.x[i];
+        old_y[i - phase_first] = back.y[i];
+        old_status[i - phase_first] = back.status[i];
+        stepDot(i, range_counts);
+    }
+
+    lock_guard<mutex> lock(profile_lock);
+    counts += range_counts;
+}
+
+void Simulator::finishDot(unsigned int i, int ox, int oy, DotStatus os, unsigned int& deaths)
+{
+    const DotStore::Buffer& back = dots.back();
+
+    // the field only catches up on the next step, lookups
+    // must keep seeing the snapshot
+    if (dconfig.density_mode == DensityMode::DENSITY_INCREMENTAL
+            && (back.x[i] != ox || back.y[i] != oy))
+        density.move(ox, oy, back.x[i], back.y[i]);
+
+    // counting the step just made, unless the dot died in it
+    const unsigned int age = DotStore::ageOf(back.birth[i], back.status[i], n_frame + 1);
+    if (back.status[i] == STATUS_DEAD)
+    {
+        this->stat_age_total += age;
+        this->stat_deaths_total += 1;
+        deaths++;
+    } else if (this->stat_max_age < age)
+        this->stat_max_age = age;
+
+    // a status carried on keeps its event
+    if (dconfig.schedule_mode == ScheduleMode::SCHEDULE_EVENTS
+            && (back.status[i] == STATUS_EATING || back.status[i] == STATUS_GENERATING)
+            && (back.status[i] != os || (i < due.size() && due[i] == DUE_END)))
+        scheduleStint(i);
+}
+
+void Simulator::takeDueEvents(void)
+{
+    const DotStore::Buffer& front = dots.front();
+    due.assign(front.size(), DUE_NONE);
+
+    DotSchedule::Event event;
+    while (schedule.next(n_frame, event)) {
+        // events of dots gone or changed since are stale
+        const unsigned int p = dots.slotOf(event.id);
+        if (p < front.size() && front.status[p] == event.status && front.count[p] == event.count)
+            due[p] = event.end ? DUE_END : DUE_DEATH;
+    }
+}
+
+void Simulator::scheduleStint(unsigned int i)
+{
+    const DotStore::Buffer& back = dots.back();
+    const int limit = (back.status[i] == STATUS_EATING) ? dconfig.eat_time : dconfig.generation_time;
+    const int count = back.count[i];
+
+    // every step from the next one rolls for death, the one starting
+    // with the count at its limit included; a count past it never ends
+    const double u = 1 - RandGenerator::uniform(rng_seed, n_frame, back.id[i], DRAW_EVENT);
+    const unsigned int death = back.birth[i]
+            + dconfig.transitions.deathAge(n_frame + 1 - back.birth[i], u);
+
+    DotSchedule::Event event;
+    event.id = back.id[i];
+    event.status = back.status[i];
+    event.end = (count <= limit && n_frame + (limit - count) + 1 < death);
+    event.frame = event.end ? n_frame + (limit - count) + 1 : death;
+    event.count = count + (event.frame - n_frame) - 1;
+    schedule.add(event);
+}
+
+void Simulator::takeDueDeaths(void)
+{
+    const DotStore::Buffer& front = dots.front();
+    due.assign(front.size(), DUE_NONE);
+
+    // dots only leave by dying, every ID taken is that of a living dot
+    deaths_by_frame.take(n_frame, dying);
+    for (DotId id : dying) {
+        const unsigned int p = dots.slotOf(id);
+        if (p < front.size())
+            due[p] = DUE_DEATH;
+    }
+}
+
+double Simulator::uniform(unsigned int i, unsigned int k)
+{
+    const size_t j = (size_t)(i - phase_first) * DRAWS_PER_DOT + k;
+    if (dconfig.rng_mode == RngMode::RNG_COUNTER) {
+        if (j < draws.size())
+            return draws[j];
+        // a serial step's newborn
+        return RandGenerator::uniform(rng_seed, n_frame, dots.back().id[i], k);
+    }
+    if (dconfig.step_mode == StepMode::STEP_PARALLEL)
+        return draws[j];
+    return RandGenerator::uniform(rng);
+}
+
+void Simulator::stepDot(unsigned int i, StepProfile::Counts& counts)
+{
+    DotStore::Buffer& back = dots.back();
+    const DotStore::Buffer& front = dots.front();
+    PROFILE_COUNT(counts.dot_steps);
+
 	bool walk = true;
     // Dot simulation proceedings for each dot:
 
     // 1. Check partner
-    const Dot* p_partner = nullptr;
-    if (dot.hasPartner()) {
-        p_partner = &dots_copy.find(dot.getPartnerId())->second;
+    // (a partner pruned on an earlier step is gone from the front buffer,
+    // only one still found there dead disbands the pair)
+    if (back.partner[i] != DotStore::NO_PARTNER) {
+        const unsigned int p = dots.slotOf(back.partner[i]);
 
-        if (p_partner->getStatus() == STATUS_DEAD) {
+        if (p < front.size() && front.status[p] == STATUS_DEAD) {
             // disband from partner
-            dot.resetPartner();
-            dot.resetCount();
-            dot.setStatus(STATUS_NORMAL);
-            p_partner = nullptr;
-        }
-    }
+            back.partner[i] = DotStore::NO_PARTNER;
+            back.count[i] = 0;
+            back.status[i] = STATUS_NORMAL;
+            if (dconfig.schedule_mode == ScheduleMode::SCHEDULE_EVENTS)
+                due[i] = DUE_END;
+        }
+    }
 
-    //	2. Calculate probability matrix
-    cdot.updateCDF(pop_density(dot, dots_copy));
+    // the rolls of a scheduled dot were made as its status started
+    const bool scheduled = (dconfig.schedule_mode == ScheduleMode::SCHEDULE_EVENTS)
+            && (back.status[i] == STATUS_EATING || back.status[i] == STATUS_GENERATING);
+    if (scheduled && due[i] == DUE_NONE) {
+        // nothing but counting until its event
+        back.count[i]++;
+        PROFILE_COUNT(counts.skipped);
+        return;
+    }
 
-    //	3. Perform a roll, apply new status
-    //		3.1. If new status = STATUS_EATING -> Set count = 1
-    //		3.2. If new status = STATUS_DEAD -> Don't walk!
-    bool prevIsEating = (dot.getStatus() == STATUS_EATING);
+    bool prevIsEating = (back.status[i] == STATUS_EATING);
 
-    cdot.setStatus(static_cast<DotStatus>(RandGenerator::genvar(cdot.getCDF())));
+    if (scheduled) {
+        if (due[i] == DUE_DEATH)
+            back.status[i] = STATUS_DEAD;
+    } else if (dconfig.schedule_mode == ScheduleMode::SCHEDULE_LIFETIMES) {
+        // the death was drawn at birth, only normal and hungry dots roll
+        if (i < due.size() && due[i] == DUE_DEATH) {
+            back.status[i] = STATUS_DEAD;
+        } else if (back.status[i] == STATUS_NORMAL || back.status[i] == STATUS_HUNGRY) {
+            const double density = rollDensity(i, counts);
+            back.status[i] = static_cast<DotStatus>(dconfig.transitions.sampleLiving(
+                    back.status[i], n_frame - back.birth[i], density, uniform(i, DRAW_STATUS)));
+        } else
+            PROFILE_COUNT(counts.skipped);
+    } else {
+        //	2. Calculate probability matrix
+        const double density = rollDensity(i, counts);
 
-    if (!prevIsEating && (cdot.getStatus() == STATUS_EATING)) {
-        cdot.resetCount();
-        cdot.incCount();
-    }
-    if (cdot.getStatus() == STATUS_DEAD) {
+        //	3. Perform a roll, apply new status
+        //		3.1. If new status = STATUS_EATING -> Set count = 1
+        //		3.2. If new status = STATUS_DEAD -> Don't walk!
+        back.status[i] = static_cast<DotStatus>(dconfig.transitions.sample(
+                back.status[i], n_frame - back.birth[i], density, uniform(i, DRAW_STATUS)));
+    }
+
+    if (!prevIsEating && (back.status[i] == STATUS_EATING)) {
+        back.count[i] = 1;
+    }
+    if (back.status[i] == STATUS_DEAD) {
         walk = false;
-        cdot.resetCount();
-        cdot.resetPartner();
+        back.count[i] = 0;
+        back.partner[i] = DotStore::NO_PARTNER;
         return;
-    }
+    }
     //	5. If status = STATUS_EATING
     //		5.1. If count == eating_time
     //			5.1.1. change to STATUS_NORMAL
@@ -155,15 +546,15 @@ void Simulator::stepDot(Dot& dot, const DotMap& dots_copy, set<unsigned int>& ge
     //		Else
     //			5.1.1. count++
     //			5.1.2. Don't walk!
-    if (cdot.getStatus() == STATUS_EATING) {
-        if (dot.getCount() == dconfig.eat_time) {
-            cdot.setStatus(STATUS_NORMAL);
-            cdot.resetCount();
+    if (back.status[i] == STATUS_EATING) {
+        if (back.count[i] == dconfig.eat_time) {
+            back.status[i] = STATUS_NORMAL;
+            back.count[i] = 0;
         } else {
-            cdot.incCount();
+            back.count[i]++;
             walk = false;
-        }
-    }
+        }
+    }
 
 
     //	6. If status is STATUS_GENERATING
@@ -174,74 +565,87 @@ void Simulator::stepDot(Dot& dot, const DotMap& dots_copy, set<unsigned int>& ge
     //		Else
     //			6.1.1. count++
     //			6.1.1. Don't walk!
-    if (cdot.getStatus() == STATUS_GENERATING) {
-//        if (cdot.getCount() == 0) {
-//            //this means the dot was either already generated
-//            //by its partner or the partner died
-//            cdot.resetPartner();
-//            cdot.setStatus(STATUS_NORMAL);
-//        }
-        if (cdot.getCount() == dconfig.generation_time)
+    if (back.status[i] == STATUS_GENERATING) {
+        if (back.count[i] == dconfig.generation_time)
         {
-            cdot.setStatus(STATUS_NORMAL);
-            cdot.resetCount();
-            cdot.resetPartner();
-
-            if (generated.find(cdot.getID()) == end(generated)) {
-                //create a new dot
-                this->addRDot(cdot.getX(), cdot.getY());
-                // mark it as generated
-                generated.insert(cdot.getID());
+            back.status[i] = STATUS_NORMAL;
+            back.count[i] = 0;
+            back.partner[i] = DotStore::NO_PARTNER;
+
+            //create a new dot
+            if (dconfig.step_mode == StepMode::STEP_PARALLEL) {
+                // born once the phase is over
+                const unsigned int k = i - phase_first;
+                born[k] = 1;
+                birth_x[k] = back.x[i];
+                birth_y[k] = back.y[i];
+            } else if (dconfig.rng_mode == RngMode::RNG_COUNTER) {
+                const DotType type = (uniform(i, DRAW_BIRTH) < 0.5) ? DotType::DOT_ALPHA : DotType::DOT_BETA;
+                this->addDot(back.x[i], back.y[i], type);
+                PROFILE_COUNT(counts.births);
+            } else {
+                this->addRDot(back.x[i], back.y[i]);
+                PROFILE_COUNT(counts.births);
             }
         } else {
-            cdot.incCount();
+            back.count[i]++;
             walk = false;
-        }
-    }
+        }
+    }
 
     //	7. If generation condition is met:
     //		7.1. Change both dots' status to STATUS_GENERATING
     //		7.2. Set count = 1 to both dots
     //		7.4. Don't walk!
-    if (cdot.getStatus() == STATUS_NORMAL || cdot.getStatus() == STATUS_LOOKING)
+    // the dot does not move before its walk, nor the snapshot during the
+    // step: the nearest dot found here is the one a looking dot walks to
+    unsigned int nearest = DotStore::NO_SLOT;
+    if (back.status[i] == STATUS_NORMAL || back.status[i] == STATUS_LOOKING)
     {
-        const Dot* p = nearestOppOf(cdot, dots_copy);
-        if (p == nullptr) {
-            if (cdot.getStatus() == STATUS_LOOKING) {
+        unsigned int p;
+        {
+            PROFILE_LOOKUP(counts.nearest_queries, counts.nearest_seconds);
+            p = nearestOppOf(i);
+        }
+        if (dconfig.nearest_check && p != nearestByScan(i))
+            nearest_mismatches++;
+        nearest = p;
+        if (p == DotStore::NO_SLOT) {
+            if (back.status[i] == STATUS_LOOKING) {
                 // stop looking, there's no dot to look for
-                cdot.setStatus(STATUS_NORMAL);
-                cdot.resetCount();
+                back.status[i] = STATUS_NORMAL;
+                back.count[i] = 0;
             }
-        } else if (cdot.getType() != p->getType()) {
-            const Dot& odot = *p;
-            if (distSqr(cdot, odot) == 0 && cdot != odot &&
-                (   cdot.getStatus() == STATUS_LOOKING
-                 || odot.getStatus() == STATUS_LOOKING)) {
+        } else if (back.type[i] != front.type[p]) {
+            const long long d2 = distSqr(back.x[i], back.y[i], front.x[p], front.y[p]);
+            if (d2 == 0 && i != p &&
+                (   back.status[i] == STATUS_LOOKING
+                 || front.status[p] == STATUS_LOOKING)) {
                 // encounter!
-                cdot.setStatus(STATUS_GENERATING);
-                cdot.resetCount();
-                cdot.incCount();
-                cdot.setPartner(odot);
+                back.status[i] = STATUS_GENERATING;
+                back.count[i] = 1;
+                back.partner[i] = front.id[p];
                 walk = false;
             }
 
             // TURTLE SOLUTION
-            if (distSqr(cdot, *p) < 2
-                && odot.getStatus() == STATUS_LOOKING
-                && odot.getType() != cdot.getType()) {
+            if (d2 < 2
+                && front.status[p] == STATUS_LOOKING
+                && front.type[p] != back.type[i]) {
                 // do not walk, let the partner do it
-                    if (cdot.getType() == DotType::DOT_ALPHA) {
+                    if (back.type[i] == DotType::DOT_ALPHA) {
                         // alpha do the X stepping
-                        if (cdot.getX() == odot.getX())
+                        if (back.x[i] == front.x[p])
                             walk = false;
                     } else {
                         // beta do the Y stepping
-                        if (cdot.getY() == odot.getY())
+                        if (back.y[i] == front.y[p])
                             walk = false;
                     }
             }
-        }
-    }
+        }
+    } else
+        PROFILE_COUNT(counts.nearest_skipped);
 
     //	8. Perform walk: If status = STATUS_LOOKING
     //		8.1. Step closer to Nearest Opposite Dot
@@ -249,21 +653,17 @@ void Simulator::stepDot(Dot& dot, const DotMap& dots_copy, set<unsigned int>& ge
     //		Else
     //		8.1. Random Walk
     if (walk) {
-        if (cdot.getStatus() == STATUS_LOOKING) {
-            if (!stepToNearest(cdot, dots_copy)) {
-                cdot.setStatus(STATUS_NORMAL);
-                cdot.resetCount();
-                randWalk(cdot);
+        if (back.status[i] == STATUS_LOOKING) {
+            if (!stepToNearest(i, nearest)) {
+                back.status[i] = STATUS_NORMAL;
+                back.count[i] = 0;
+                randWalk(i);
             }
         } else
-            randWalk(cdot);
-    }
+            randWalk(i);
+    }
 
-    //	8. Increment Dot age.
-    cdot.incAge();
-
-    if (this->stat_max_age < cdot.getAge() && cdot.getStatus() != STATUS_DEAD)
-        this->stat_max_age = cdot.getAge();
+    //	8. Dot age goes up with the frame number
 }
 
 int Simulator::getWidth() const noexcept
@@ -300,119 +700,359 @@ unsigned int Simulator::getMaxDots() const
 	return this->stat_max_dots;
 }
 
+double Simulator::getDensityError()
+{
+	if (dconfig.density_mode == DensityMode::DENSITY_INCREMENTAL)
+		return density.measureDrift();
+	if (dconfig.density_mode == DensityMode::DENSITY_TREE)
+		return density_tree.measureError();
+
+	if (dconfig.density_mode == DensityMode::DENSITY_DIRECT && dconfig.density_single) {
+		// sample the snapshot against double precision sums
+		const unsigned int n = snap_x.size();
+		const int* xs = snap_x.data();
+		const int* ys = snap_y.data();
+		const unsigned int stride = max(1u, n / 1024);
+		double error = 0;
+		for (unsigned int i = 0 ; i < n ; i += stride) {
+			double exact = PairKernels::sumAt(xs[i], ys[i], xs, ys, n, i, grid_w, grid_h);
+			double sum = (i < snap_density.size()) ? snap_density[i]
+					: PairKernels::sumAt(xs[i], ys[i], xs, ys, n, i, grid_w, grid_h, true);
+			if (exact > 0 && std::isfinite(exact))
+				error = max(error, fabs(sum - exact) / exact);
+		}
+		return error;
+	}
+	return 0;
+}
+
+unsigned long long Simulator::getNearestMismatches() const
+{
+	return nearest_mismatches;
+}
+
+unsigned long Simulator::getBufferGrowths() const
+{
+	return dots.getGrowths();
+}
+
+size_t Simulator::getMemoryUsage() const
+{
+	return dots.getMemoryUsage() + grid.getMemoryUsage() + density_tree.getMemoryUsage()
+			+ DotStore::bytesOf(snap_density) + DotStore::bytesOf(snap_x)
+			+ DotStore::bytesOf(snap_y) + DotStore::bytesOf(draws)
+			+ DotStore::bytesOf(old_x) + DotStore::bytesOf(old_y)
+			+ DotStore::bytesOf(old_status) + DotStore::bytesOf(birth_x)
+			+ DotStore::bytesOf(birth_y) + DotStore::bytesOf(born)
+			+ schedule.getMemoryUsage() + DotStore::bytesOf(due)
+			+ deaths_by_frame.getMemoryUsage() + DotStore::bytesOf(dying);
+}
+
+const StepProfile& Simulator::getProfile(void) const
+{
+	return this->profile;
+}
+
+void Simulator::resetProfile(void)
+{
+	const bool has_counters = profile.has_counters;
+	this->profile = StepProfile();
+	this->profile.has_counters = has_counters;
+}
+
+void Simulator::setProfiling(bool on)
+{
+	this->dconfig.profile = on;
+}
+
 unsigned int Simulator::getFrame() const
 {
 	return this->n_frame;
 }
 
-double Simulator::distSqr(const Dot& d1, const Dot &d2) const
+long long Simulator::distSqr(int x1, int y1, int x2, int y2) const
 {
-	int dx = abs(d1.getX() - d2.getX());
-	if ( dx > this->grid_w/2 )
-		dx = this->grid_w - dx;
+	int dx = abs(x1 - x2);
+	dx = min(dx, this->grid_w - dx);
 
-	int dy = abs(d1.getY() - d2.getY());
-	if ( dy > this->grid_h/2 )
-		dy = this->grid_h - dy;
+	int dy = abs(y1 - y2);
+	dy = min(dy, this->grid_h - dy);
 
-	return (double)(dx*dx + dy*dy);
+	return (long long)dx*dx + (long long)dy*dy;
 }
 
-void Simulator::randWalk(Dot& dot) const
+void Simulator::move(int& x, int& y, int d)
+{
+	switch (d)
+	{
+	case 0:
+		x++;
+		break;
+	case 1:
+		y--;
+		break;
+	case 2:
+		x--;
+		break;
+	case 3:
+		y++;
+		break;
+	}
+}
+
+void Simulator::randWalk(unsigned int i)
 {
 	const int w = this->getWidth();
 	const int h = this->getHeight();
 	double cprob[] = { 0.25, 0.5, 0.75, 1 };
-	int d = RandGenerator::genvar(cprob);
-	dot.move(d);
-	const int x = dot.getX(), y = dot.getY();
-	dot.setPos((x+w) % w, (y+h) % h);
+	int d = RandGenerator::genvar(cprob, 4, uniform(i, DRAW_WALK));
+	DotStore::Buffer& back = dots.back();
+	int x = back.x[i], y = back.y[i];
+	move(x, y, d);
+	back.x[i] = (x+w) % w;
+	back.y[i] = (y+h) % h;
 
 }
 
-double Simulator::pop_density(const Dot& this_dot, const DotMap& dots_copy) const
+double Simulator::rollDensity(unsigned int i, StepProfile::Counts& counts) const
+{
+    if (!TransitionTable::readsDensity(dots.back().status[i])) {
+        PROFILE_COUNT(counts.density_skipped);
+        return 0;
+    }
+    PROFILE_LOOKUP(counts.density_evals, counts.density_seconds);
+    return pop_density(i);
+}
+
+double Simulator::pop_density(unsigned int i) const
 {
-	double tmp = 0;
+	const DotStore::Buffer& back = dots.back();
+	const DotStore::Buffer& front = dots.front();
+
+	if (dconfig.density_mode != DensityMode::DENSITY_DIRECT) {
+		const int x = back.x[i], y = back.y[i];
+		double sum;
+		unsigned int others;
+		if (dconfig.density_mode == DensityMode::DENSITY_TREE) {
+			sum = density_tree.sumAt(x, y, others);
+		} else {
+			sum = density.sumAt(x, y);
+			others = density.countAt(x, y);
+		}
+
+		// dots sharing the position count as infinitely close
+		if (i < front.size())
+			others--;
+		if (others > 0)
+			return dconfig.dot_density / 0.0;
 
-	for(auto it = begin(dots_copy); it != end(dots_copy) ; ++it) {
-        const auto& d = it->second;
-		if (this_dot == d)
-			continue;
+		return dconfig.dot_density * sum;
+	}
 
-		tmp += dconfig.dot_density / (distSqr(this_dot, d));
-	}
-	return tmp;
+	// the snapshot's sums may be ready, otherwise a pass of its own, which
+	// leaves the dot out unless it is a newborn
+	if (i < snap_density.size())
+		return dconfig.dot_density * snap_density[i];
+
+	const unsigned int n = front.size();
+	return dconfig.dot_density * PairKernels::sumAt(back.x[i], back.y[i],
+			snap_x.data(), snap_y.data(), n, min(i, n), grid_w, grid_h,
+			dconfig.density_single);
 }
 
-const Dot* Simulator::nearestOppOf(const Dot& d1, const map<unsigned int, Dot>& dots_copy) const
+unsigned int Simulator::nearestOppOf(unsigned int i) const
 {
-	const Dot* ndot = nullptr;
-	const DotType t = d1.getType();
+	const DotStore::Buffer& back = dots.back();
+	const DotStore::Buffer& front = dots.front();
 
-    auto it = begin(dots_copy);
+	if (front.empty())
+		return DotStore::NO_SLOT;
 
-	double nd = grid_w*grid_w + grid_h*grid_h;
+	// the first dot is only a fallback, never a candidate
+	const unsigned int head = 0;
+	const DotType ot = (back.type[i] == DotType::DOT_ALPHA)
+			? DotType::DOT_BETA : DotType::DOT_ALPHA;
 
-    ndot = &(it->second);
-	++it;
-
-	for( ; it != end(dots_copy); ++it) {
-	    const Dot& od = it->second;
-		if (d1 == od
-			|| od.getType() == t
-			|| (   od.getStatus() != STATUS_NORMAL
-                && od.getStatus() != STATUS_LOOKING) )
-				continue;
+	// an encounter only needs a look at the dot's own cell
+	unsigned int ndot = grid.occupantAt(back.x[i], back.y[i], ot, head);
+	if (ndot == DotStore::NO_SLOT)
+		ndot = grid.nearestOf(back.x[i], back.y[i], ot, head);
 
-		double tdist = distSqr(d1, od);
-		if (tdist < nd) {
-			nd = tdist;
-			ndot = &od;
-		}
-	}
-
-	return ndot;
+	return (ndot != DotStore::NO_SLOT) ? ndot : head;
 }
 
-void Simulator::stepTo(Dot& d1, const Dot& d2) const
+void Simulator::stepTo(unsigned int i, int tx, int ty)
 {
-	if (d1.getX() == d2.getX() && d1.getY() == d2.getY())
+	DotStore::Buffer& back = dots.back();
+	int x = back.x[i], y = back.y[i];
+
+	if (x == tx && y == ty)
 		return;
-
-	int dx = abs(d1.getX() - d2.getX());
+
+	int dx = abs(x - tx);
 	if ( dx > this->grid_w/2 )
 		dx = this->grid_w - dx;
-
-	int dy = abs(d1.getY() - d2.getY());
+
+	int dy = abs(y - ty);
 	if ( dy > this->grid_h/2 )
 		dy = this->grid_h - dy;
-
+
     if (dx == dy) {
-        if (d1.getType() == DotType::DOT_ALPHA)
-            d1.move( (d2.getX() > d1.getX()) ? 0 : 2 ); // Alpha prioritizes X
+        if (back.type[i] == DotType::DOT_ALPHA)
+            move(x, y, (tx > x) ? 0 : 2 ); // Alpha prioritizes X
         else
-            d1.move( (d2.getY() > d1.getY()) ? 3 : 1 ); // Beta prioritizes Y
+            move(x, y, (ty > y) ? 3 : 1 ); // Beta prioritizes Y
     }
 	if (dx > dy)
-		d1.move( (d2.getX() > d1.getX()) ? 0 : 2 ); // right or left
+		move(x, y, (tx > x) ? 0 : 2 ); // right or left
 	else
-		d1.move( (d2.getY() > d1.getY()) ? 3 : 1 ); // down or up
-
-	d1.setPos(d1.getX() % this->getWidth(), d1.getY() % this->getHeight());
+		move(x, y, (ty > y) ? 3 : 1 ); // down or up
+
+	// the second move may overshoot the target, and the edge with it
+	const int w = this->getWidth(), h = this->getHeight();
+	back.x[i] = (x + w) % w;
+	back.y[i] = (y + h) % h;
 }
 
-bool Simulator::stepToNearest(Dot& d1, const DotMap& dots_copy)
+unsigned int Simulator::nearestByScan(unsigned int i) const
+{
+	const DotStore::Buffer& back = dots.back();
+	const DotStore::Buffer& front = dots.front();
+
+	if (front.empty())
+		return DotStore::NO_SLOT;
+
+	// the lowest slot of the nearest ones, the first dot as a fallback
+	unsigned int best = 0;
+	long long best_d = -1;
+	for (unsigned int p = 1 ; p < front.size() ; p++) {
+		if (front.type[p] == back.type[i]
+				|| (front.status[p] != STATUS_NORMAL && front.status[p] != STATUS_LOOKING))
+			continue;
+		const long long d = distSqr(back.x[i], back.y[i], front.x[p], front.y[p]);
+		if (best_d < 0 || d < best_d) {
+			best = p;
+			best_d = d;
+		}
+	}
+	return best;
+}
+
+bool Simulator::stepToNearest(unsigned int i, unsigned int p)
 {
-	const Dot* p_t_d = nearestOppOf(d1, dots_copy);
-	if (p_t_d == nullptr)
+	if (p == DotStore::NO_SLOT)
 		return false;
 
-	stepTo(d1, *p_t_d);
+	stepTo(i, dots.front().x[p], dots.front().y[p]);
 	return true;
-}
-
+}
+
 Simulator::DotMap Simulator::getDots(void) const
 {
-    // just let it copy
-    return this->dots;
+    // stand-alone copies of every dot
+    DotMap copy;
+    for (unsigned int i = 0 ; i < dots.size() ; i++)
+        copy.emplace_hint(end(copy), dots.front().id[i], dots.view(i, n_frame));
+    return copy;
+}
+
+DotStore::Range Simulator::view(void) const
+{
+	return dots.range(n_frame);
+}
+
+DotStore::Census Simulator::getCensus(void) const
+{
+	return dots.census();
+}
+
+bool Simulator::save(const string& filename, ostream& log) const
+{
+	Checkpoint::Writer out;
+	out.value(grid_w);
+	out.value(grid_h);
+	out.value(rng_seed);
+	confFields(out, dconfig);
+
+	out.value(n_frame);
+	out.value(stat_age_total);
+	out.value(stat_deaths_total);
+	out.value(stat_max_age);
+	out.value(stat_max_dots);
+	out.value(next_id);
+	out.value(rng);
+
+	dots.save(out);
+	if (dconfig.density_mode == DensityMode::DENSITY_INCREMENTAL)
+		density.save(out);
+	if (dconfig.schedule_mode == ScheduleMode::SCHEDULE_EVENTS)
+		schedule.save(out);
+	else if (dconfig.schedule_mode == ScheduleMode::SCHEDULE_LIFETIMES)
+		deaths_by_frame.save(out);
+	return out.write(filename, log);
+}
+
+bool Simulator::restore(const string& filename, unique_ptr<Simulator>& p_simulator, ostream& log)
+{
+	Checkpoint::Reader in;
+	if (!in.open(filename, log))
+		return false;
+
+	int w = 0, h = 0;
+	unsigned int seed = 0;
+	DotConf dotconf;
+	in.value(w);
+	in.value(h);
+	in.value(seed);
+	confFields(in, dotconf);
+	if (!in.good() || w <= 0 || h <= 0 || w > DotStore::MAX_GRID || h > DotStore::MAX_GRID
+			|| dotconf.eat_time < 1 || dotconf.eat_time > DotStore::MAX_COUNT
+			|| dotconf.generation_time < 1 || dotconf.generation_time > DotStore::MAX_COUNT
+			|| !(dotconf.death_chance_maj >= 0
+				&& dotconf.death_chance_maj < TransitionTable::MAX_AGES)
+			|| dotconf.step_threads > ThreadPool::MAX_THREADS
+			|| !(dotconf.density_theta >= 0 && isfinite(dotconf.density_theta))
+			|| !validBool(dotconf.density_single) || !validBool(dotconf.nearest_check)
+			|| !validBool(dotconf.profile)
+			|| static_cast<int>(dotconf.density_mode) < 0
+			|| dotconf.density_mode > DensityMode::DENSITY_TREE
+			|| static_cast<int>(dotconf.step_mode) < 0
+			|| dotconf.step_mode > StepMode::STEP_PARALLEL
+			|| static_cast<int>(dotconf.rng_mode) < 0
+			|| dotconf.rng_mode > RngMode::RNG_COUNTER
+			|| static_cast<int>(dotconf.schedule_mode) < 0
+			|| dotconf.schedule_mode > ScheduleMode::SCHEDULE_LIFETIMES) {
+		log << filename << " is damaged" << endl;
+		return false;
+	}
+	dotconf.updateLookProb();
+
+	unique_ptr<Simulator> p_sim(new Simulator(seed, dotconf, w, h));
+	in.value(p_sim->n_frame);
+	in.value(p_sim->stat_age_total);
+	in.value(p_sim->stat_deaths_total);
+	in.value(p_sim->stat_max_age);
+	in.value(p_sim->stat_max_dots);
+	in.value(p_sim->next_id);
+	in.value(p_sim->rng);
+
+	p_sim->dots.restore(in, w, h, p_sim->next_id, p_sim->n_frame);
+	if (dotconf.density_mode == DensityMode::DENSITY_INCREMENTAL)
+		p_sim->density.restore(in);
+	if (dotconf.schedule_mode == ScheduleMode::SCHEDULE_EVENTS)
+		p_sim->schedule.restore(in);
+	else if (dotconf.schedule_mode == ScheduleMode::SCHEDULE_LIFETIMES)
+		p_sim->deaths_by_frame.restore(in);
+
+	if (!in.complete() || !RandGenerator::valid(p_sim->rng)) {
+		log << filename << " is damaged" << endl;
+		return false;
+	}
+	p_simulator = std::move(p_sim);
+	return true;
+}
+
+void Simulator::record(Trajectory::Writer& writer) const
+{
+	writer.write(n_frame, dots.front());
 }
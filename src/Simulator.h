@@ -25,22 +25,44 @@
 #ifndef Simulator_H
 #define Simulator_H
 
+#include <atomic>
+#include <chrono>
 #include <map>
-#include <set>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "BucketWheel.h"
 #include "Dot.h"
 #include "DotConf.h"
+#include "DotSchedule.h"
+#include "DotStore.h"
 #include "RandGenerator.h"
+#include "SpatialGrid.h"
+#include "DensityField.h"
+#include "DensityTree.h"
+#include "ThreadPool.h"
+#include "StepProfile.h"
+#include "PerfCounters.h"
+#include "Trajectory.h"
 #include <ostream>
 
 class Simulator
 {
 private:
-    std::map<unsigned int, Dot> dots;
+    DotStore dots;
 
 	int grid_w;
 	int grid_h;
 
 	unsigned int n_frame;
+	/** Key of the counter-based random streams */
+	unsigned int rng_seed;
+	/** This simulator's own random sequence (RNG_GLOBAL mode and random
+	 * dots), and the ID of its next dot: simulators do not share any
+	 * state, and may run side by side in one process */
+	RandGenerator::State rng;
+	DotId next_id;
 
 	unsigned int stat_age_total;
 	unsigned int stat_deaths_total;
@@ -49,8 +71,89 @@ private:
 
 	DotConf dconfig;
 
+	/** Bucket grid over the current step's snapshot. */
+	SpatialGrid grid;
+
+	/** Density field of the current step's snapshot
+	 * (DENSITY_FFT and DENSITY_INCREMENTAL only). */
+	DensityField density;
+
+	/** Density tree of the current step's snapshot (DENSITY_TREE only). */
+	DensityTree density_tree;
+
+	/** Direct density sums of the snapshot, by slot, when most of its dots
+	 * read them (empty otherwise, each sum being made on demand), and its
+	 * positions widened for the pair kernels (DENSITY_DIRECT only). */
+	std::vector<double> snap_density;
+	std::vector<int> snap_x;
+	std::vector<int> snap_y;
+
+	/** Coming status changes of the eating and generating dots, and
+	 * which of them are due in the current step, by slot: DUE_NONE, or
+	 * DUE_DEATH or DUE_END for a dot whose death or end of status comes
+	 * in it (SCHEDULE_EVENTS only). */
+	DotSchedule schedule;
+	std::vector<unsigned char> due;
+	static constexpr unsigned char DUE_NONE = 0;
+	static constexpr unsigned char DUE_DEATH = 1;
+	static constexpr unsigned char DUE_END = 2;
+	/** Every living dot's ID, filed by the step it dies in, and the IDs
+	 * taken off for the current step (SCHEDULE_LIFETIMES only); <tt>due</tt>
+	 * then marks those dots with DUE_DEATH. */
+	BucketWheel deaths_by_frame;
+	std::vector<DotId> dying;
+
+	/** Worker threads (STEP_PARALLEL only). */
+	std::unique_ptr<ThreadPool> p_pool;
+
+	/** Random draws of each dot in a parallel phase, or in a serial
+	 * step with counter-based streams: its new status, its random walk
+	 * and, if it gives birth, the newborn's type. */
+	static constexpr unsigned int DRAW_STATUS = 0;
+	static constexpr unsigned int DRAW_WALK = 1;
+	static constexpr unsigned int DRAW_BIRTH = 2;
+	static constexpr unsigned int DRAWS_PER_DOT = 3;
+	/** Draw of the step in which a dot starts eating or generating,
+	 * which sets its death (SCHEDULE_EVENTS only); it comes from the
+	 * dot's counter-based stream whatever the rng_mode */
+	static constexpr unsigned int DRAW_EVENT = 3;
+	/** Draw of a dot's lifetime as it is born (SCHEDULE_LIFETIMES only),
+	 * from its counter-based stream as well */
+	static constexpr unsigned int DRAW_LIFETIME = 4;
+
+	/** First slot of the current parallel phase; the arrays below are
+	 * indexed from it (STEP_PARALLEL only, and <tt>draws</tt> in
+	 * RNG_COUNTER mode). */
+	unsigned int phase_first;
+	std::vector<double> draws;
+	/** Positions and statuses before stepping */
+	std::vector<int> old_x;
+	std::vector<int> old_y;
+	std::vector<DotStatus> old_status;
+	/** Births, made once the phase is over */
+	std::vector<int> birth_x;
+	std::vector<int> birth_y;
+	std::vector<unsigned char> born;
+
+	/** Profile of the steps so far (see DotConf::profile), and the phase
+	 * being timed: -1 for none, or when it started and the hardware
+	 * counters then. The counters are opened by the first profiled step,
+	 * on the thread running it. */
+	StepProfile profile;
+	PerfCounters perf;
+	bool perf_tried;
+	int profile_phase;
+	std::chrono::steady_clock::time_point phase_start;
+	unsigned long long phase_counters[StepProfile::N_COUNTERS];
+	/** Guards profile.counts while parallel phases add to it */
+	std::mutex profile_lock;
+
+	/** Nearest dot queries found wrong by a full scan so far
+	 * (DotConf::nearest_check only) */
+	std::atomic<unsigned long long> nearest_mismatches;
+
 public:
-    using DotMap = std::map<unsigned int, Dot>;
+    using DotMap = std::map<DotId, Dot>;
 
 	Simulator(unsigned int rseed, const DotConf& dconfig, int nw, int nh);
 	~Simulator();
@@ -60,38 +163,151 @@ public:
 
 	unsigned int getFrame() const;
 
-	unsigned int addDot(int x, int y, DotType type);
-	unsigned int addRDot(int x, int y);
-	unsigned int addRDot();
+	DotId addDot(int x, int y, DotType type);
+	DotId addRDot(int x, int y);
+	DotId addRDot();
 
 	void step();
 
 	unsigned int ndots() const;
+	/** Copy every dot into a stand-alone Dot, keyed by ID. This allocates
+	 * the whole map; view() reads the dots in place. */
 	DotMap getDots(void) const;
+	/** The dots as the last step left them, dead ones included, in ID
+	 * order and without copying. Only valid until the next step. */
+	DotStore::Range view(void) const;
+	/** \return the number of dots of each type and status, as view()
+	 * would count them */
+	DotStore::Census getCensus(void) const;
 
 	double getDeathAverage() const;
 	double getNDeaths() const;
 	unsigned int getMaxAge() const;
 	unsigned int getMaxDots() const;
+
+	/** Check the density engine against the exact kernel sum.
+	 * \return the largest relative error of the density field or tree,
+	 * or 0 for engines which are exact by construction
+	 */
+	double getDensityError();
+
+	/** \return how many nearest dot queries so far differed from a full
+	 * scan of the snapshot, always 0 unless DotConf::nearest_check is set;
+	 * each step with any also reports them to stderr */
+	unsigned long long getNearestMismatches() const;
+
+	/** \return how many times the dot buffers had to grow so far; once
+	 * the population stops growing, steps no longer add to it */
+	unsigned long getBufferGrowths() const;
+
+	/** \return the bytes held for the dots: their buffers, the lookup
+	 * grid and tree, and the per-dot scratch of a step. The density field
+	 * of DENSITY_FFT and DENSITY_INCREMENTAL is left out, as its size only
+	 * depends on the world's. */
+	size_t getMemoryUsage() const;
+
+	/** \return the profile of the steps made while profiling, since the
+	 * start or the last reset; always empty in a DOTS_NO_PROFILE build */
+	const StepProfile& getProfile(void) const;
+	void resetProfile(void);
+	/** Start or stop profiling the following steps, keeping the profile
+	 * so far. */
+	void setProfiling(bool on);
+
+	/** Write a checkpoint of the whole simulation: every dot, the frame
+	 * number, statistics, configuration, the random sequence and the next
+	 * dot ID. Not to be called during a step.
+	 * \param log where errors are reported
+	 */
+	bool save(const std::string& filename, std::ostream& log) const;
+
+	/** Create a simulator from a checkpoint written by save(). Its steps
+	 * then go on exactly as those of the saved simulator would have.
+	 * \param log where errors are reported
+	 */
+	static bool restore(const std::string& filename,
+			std::unique_ptr<Simulator>& p_simulator, std::ostream& log);
+
+	/** Record the current frame, as the last step left it. */
+	void record(Trajectory::Writer& writer) const;
 
 private:
-	void stepDot(Dot& cdot, const DotMap& dots_copy, std::set<unsigned int>& generated);
+	/** Step every dot in phases run on the thread pool. Each phase steps
+	 * the dots born in the previous one; a dot's draws are made before
+	 * the phase starts (from its own stream, or from the simulator's own
+	 * sequence in slot order), and its births wait for the phase to end, so the
+	 * outcome does not depend on the number of threads.
+	 */
+	void stepParallel(unsigned int& deaths, StepProfile::Counts& counts);
+	/** Load and step the slots [first, last) of a parallel phase. */
+	void stepRange(unsigned int first, unsigned int last, StepProfile::Counts& counts);
+	/** Stop timing the current phase, and start timing phase
+	 * <tt>next</tt>, -1 for none. */
+	void profilePhase(int next);
+	/** Account for a stepped dot in the density field, statistics and
+	 * schedule.
+	 * \param ox
+	 * \param oy
+	 * \param os the dot's position and status before the step
+	 */
+	void finishDot(unsigned int i, int ox, int oy, DotStatus os, unsigned int& deaths);
+	/** Mark the dots whose events are due in this step (SCHEDULE_EVENTS
+	 * only). */
+	void takeDueEvents(void);
+	/** Schedule the death or end of status of the dot in slot i, which
+	 * has just started eating or generating. */
+	void scheduleStint(unsigned int i);
+	/** Mark the dots which die in this step (SCHEDULE_LIFETIMES only). */
+	void takeDueDeaths(void);
+
+	/** Random draw k of the dot in slot i, uniform in [0,1]. With
+	 * counter-based streams it only depends on the dot's ID and the
+	 * frame, not on the order in which dots are stepped. */
+	double uniform(unsigned int i, unsigned int k);
+
+	/** Step the dot in slot i of the back buffer, once loaded.
+	 * \param counts where lookups and births are counted */
+	void stepDot(unsigned int i, StepProfile::Counts& counts);
 
-	void randWalk(Dot& dot) const;
-	double distSqr(const Dot& d1, const Dot &d2) const;
+	/** Move a position one step, see Dot::move. The result may be off the
+	 * world's edges by one, positions are only wrapped once stored. */
+	static void move(int& x, int& y, int d);
+	void randWalk(unsigned int i);
+	/** \return the squared distance across the torus, in long long as
+	 * half a MAX_GRID world each way squares to 2^31 */
+	long long distSqr(int x1, int y1, int x2, int y2) const;
 
-	double pop_density(const Dot& d, const DotMap& dots_copy) const;
+    /** Calculate the population density around the dot in slot i, as the
+     * sum of dot_density / distSqr over every other dot in dots_copy.
+     * \param i
+     * \return the density, infinite if another dot shares the dot's position
+     */
+	double pop_density(unsigned int i) const;
+	/** The density around the dot in slot i, for its roll: only evaluated
+	 * when its status's transition reads it, 0 otherwise. */
+	double rollDensity(unsigned int i, StepProfile::Counts& counts) const;
 
-    /** Get a reference to the nearest dot of d1 with the opposite
+    /** Get the nearest dot to the one in slot i with the opposite
      * type and a non-busy state (either normal or looking)
-     * \param d1
-     * \param dots_copy
-     * \return the nearest opposing dot of d1, or nullptr if no other dot is available.
-     */
-	const Dot* nearestOppOf(const Dot& d1, const DotMap& dots_copy) const;
-
-	bool stepToNearest(Dot& d1, const DotMap& dots_copy);
-	void stepTo(Dot& d1, const Dot& d2) const;
+     * The search runs over the bucket grid, which must have been rebuilt
+     * from dots_copy. Like the former full scan, the first dot in
+     * dots_copy is only returned when no other dot qualifies.
+     * \param i
+     * \return the nearest opposing dot's slot in dots_copy, or
+     * DotStore::NO_SLOT if no other dot is available.
+     */
+	unsigned int nearestOppOf(unsigned int i) const;
+	/** nearestOppOf by a full scan of dots_copy, to check it against
+	 * (DotConf::nearest_check only). */
+	unsigned int nearestByScan(unsigned int i) const;
+
+	/** Step the dot in slot i towards the dot in slot p of dots_copy, the
+	 * nearest one found for it in this step.
+	 * \return false if there is none, p being DotStore::NO_SLOT
+	 */
+	bool stepToNearest(unsigned int i, unsigned int p);
+	/** Move the dot in slot i one step towards (tx,ty). */
+	void stepTo(unsigned int i, int tx, int ty);
 };
 
 
@@ -0,0 +1,224 @@
+/** \file SpatialGrid.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class SpatialGrid
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+SpatialGrid::SpatialGrid(void)
+:	grid_w(1),
+	grid_h(1),
+	cell(1),
+	ncx(1),
+	ncy(1)
+{
+}
+
+int SpatialGrid::cellWidth(int c) const
+{
+	// the last column may be cut short by the world's edge
+	return min(this->cell, this->grid_w - c * this->cell);
+}
+
+int SpatialGrid::cellHeight(int c) const
+{
+	return min(this->cell, this->grid_h - c * this->cell);
+}
+
+unsigned long long SpatialGrid::distSqr(int x1, int y1, int x2, int y2) const
+{
+	// same metric as Simulator::distSqr
+	int dx = abs(x1 - x2);
+	if ( dx > this->grid_w/2 )
+		dx = this->grid_w - dx;
+
+	int dy = abs(y1 - y2);
+	if ( dy > this->grid_h/2 )
+		dy = this->grid_h - dy;
+
+	return (unsigned long long)dx*dx + (unsigned long long)dy*dy;
+}
+
+void SpatialGrid::rebuild(const DotStore::Buffer& dots, int w, int h)
+{
+	this->grid_w = w;
+	this->grid_h = h;
+	const unsigned int ndots = dots.size();
+
+	unsigned int n = 0;
+	for (unsigned int i = 0 ; i < ndots ; i++) {
+		DotStatus s = dots.status[i];
+		if (s == STATUS_NORMAL || s == STATUS_LOOKING)
+			n++;
+	}
+
+	// aim for about one dot per cell
+	this->cell = max(1, (int)sqrt((double)w * h / max(n, 1u)));
+	this->ncx = (w + cell - 1) / cell;
+	this->ncy = (h + cell - 1) / cell;
+	const unsigned int ncells = (unsigned int)(ncx * ncy);
+
+	for (int t = 0 ; t < 2 ; t++) {
+		cell_start[t].assign(ncells + 1, 0);
+	}
+
+	// counting sort by cell (stable, so each bucket stays in ID order)
+	for (unsigned int i = 0 ; i < ndots ; i++) {
+		DotStatus s = dots.status[i];
+		if (s != STATUS_NORMAL && s != STATUS_LOOKING)
+			continue;
+		int c = (dots.y[i] / cell) * ncx + dots.x[i] / cell;
+		cell_start[(int)dots.type[i]][c + 1]++;
+	}
+	for (int t = 0 ; t < 2 ; t++) {
+		for (unsigned int c = 0 ; c < ncells ; c++)
+			cell_start[t][c + 1] += cell_start[t][c];
+		entries[t].resize(cell_start[t][ncells]);
+	}
+
+	for (int t = 0 ; t < 2 ; t++)
+		cursor[t].assign(begin(cell_start[t]), end(cell_start[t]) - 1);
+	for (unsigned int i = 0 ; i < ndots ; i++) {
+		DotStatus s = dots.status[i];
+		if (s != STATUS_NORMAL && s != STATUS_LOOKING)
+			continue;
+		int t = (int)dots.type[i];
+		int c = (dots.y[i] / cell) * ncx + dots.x[i] / cell;
+		entries[t][cursor[t][c]++] = Entry { dots.x[i], dots.y[i], i };
+	}
+}
+
+unsigned int SpatialGrid::occupantAt(int x, int y, DotType type, unsigned int excluded) const
+{
+	const int t = (int)type;
+	const int c = (y / cell) * ncx + x / cell;
+
+	// buckets are in slot order, the first match is the lowest
+	for (unsigned int i = cell_start[t][c] ; i < cell_start[t][c + 1] ; i++) {
+		const Entry& e = entries[t][i];
+		if (e.x == x && e.y == y && e.slot != excluded)
+			return e.slot;
+	}
+	return DotStore::NO_SLOT;
+}
+
+unsigned int SpatialGrid::nearestOf(int x, int y, DotType type, unsigned int excluded) const
+{
+	const int t = (int)type;
+	if (entries[t].empty())
+		return DotStore::NO_SLOT;
+
+	const int cx = x / cell;
+	const int cy = y / cell;
+
+	// the search window never spans more than the whole grid,
+	// so that no cell is visited twice after wrapping around
+	const int ax = (ncx - 1) / 2, bx = ncx - 1 - ax;
+	const int ay = (ncy - 1) / 2, by = ncy - 1 - ay;
+
+	// world units covered by the window on each side of (x,y)
+	int ext_left = x - cx * cell;
+	int ext_right = cx * cell + cellWidth(cx) - 1 - x;
+	int ext_up = y - cy * cell;
+	int ext_down = cy * cell + cellHeight(cy) - 1 - y;
+
+	unsigned int best = DotStore::NO_SLOT;
+	unsigned long long best_d = numeric_limits<unsigned long long>::max();
+
+	auto visit = [&](int ox, int oy) {
+		const int c = ((cy + oy + ncy) % ncy) * ncx + (cx + ox + ncx) % ncx;
+		for (unsigned int i = cell_start[t][c] ; i < cell_start[t][c + 1] ; i++) {
+			const Entry& e = entries[t][i];
+			if (e.slot == excluded)
+				continue;
+			unsigned long long d = distSqr(x, y, e.x, e.y);
+			if (d < best_d || (d == best_d && e.slot < best)) {
+				best = e.slot;
+				best_d = d;
+			}
+		}
+	};
+
+	int pxlo = 0, pxhi = -1, pylo = 0, pyhi = -1;
+	for (int r = 0 ; ; r++) {
+		const int xlo = -min(r, ax), xhi = min(r, bx);
+		const int ylo = -min(r, ay), yhi = min(r, by);
+
+		// visit the ring: cells in this window but not in the previous one
+		for (int oy = ylo ; oy <= yhi ; oy++) {
+			if (oy < pylo || oy > pyhi) {
+				for (int ox = xlo ; ox <= xhi ; ox++)
+					visit(ox, oy);
+			} else {
+				if (xlo < pxlo)
+					visit(xlo, oy);
+				if (xhi > pxhi)
+					visit(xhi, oy);
+			}
+		}
+
+		if (r > 0) {
+			if (xlo < pxlo) ext_left += cellWidth((cx + xlo + ncx) % ncx);
+			if (xhi > pxhi) ext_right += cellWidth((cx + xhi) % ncx);
+			if (ylo < pylo) ext_up += cellHeight((cy + ylo + ncy) % ncy);
+			if (yhi > pyhi) ext_down += cellHeight((cy + yhi) % ncy);
+		}
+		pxlo = xlo; pxhi = xhi; pylo = ylo; pyhi = yhi;
+
+		const bool full_x = (xhi - xlo + 1 == ncx);
+		const bool full_y = (yhi - ylo + 1 == ncy);
+		if (full_x && full_y)
+			break;
+
+		// any dot outside the window is at least this far away;
+		// a tie may still hide a lower slot, hence the strict comparison
+		unsigned long long bound = numeric_limits<unsigned long long>::max();
+		if (!full_x) {
+			unsigned long long e = (unsigned long long)min(ext_left, ext_right) + 1;
+			bound = min(bound, e * e);
+		}
+		if (!full_y) {
+			unsigned long long e = (unsigned long long)min(ext_up, ext_down) + 1;
+			bound = min(bound, e * e);
+		}
+		if (best != DotStore::NO_SLOT && best_d < bound)
+			break;
+	}
+
+	return best;
+}
+
+size_t SpatialGrid::getMemoryUsage(void) const
+{
+	size_t bytes = 0;
+	for (int t = 0 ; t < 2 ; t++) {
+		bytes += DotStore::bytesOf(cell_start[t]) + DotStore::bytesOf(entries[t])
+				+ DotStore::bytesOf(cursor[t]);
+	}
+	return bytes;
+}
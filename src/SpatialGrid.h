@@ -0,0 +1,94 @@
+/** \file SpatialGrid.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SpatialGrid_H
+#define SpatialGrid_H
+
+#include <vector>
+#include "DotStore.h"
+
+/** Toroidal bucket grid over the non-busy dots of a world snapshot.
+ * Dots are bucketed by cell, with one bucket list per DotType, and only
+ * dots in STATUS_NORMAL or STATUS_LOOKING are kept (those are the only
+ * ones a nearest opposite query may return).
+ */
+class SpatialGrid
+{
+private:
+	struct Entry
+	{
+		DotStore::Coord x;
+		DotStore::Coord y;
+		unsigned int slot;
+	};
+
+	int grid_w;
+	int grid_h;
+
+	/** Side of each (square) cell, in world units. */
+	int cell;
+	/** Number of cells along X and Y. */
+	int ncx;
+	int ncy;
+
+	/** Start of each cell's bucket in <tt>entries</tt>, one table per type. */
+	std::vector<unsigned int> cell_start[2];
+	/** Bucketed dots, one list per type. */
+	std::vector<Entry> entries[2];
+	/** Next free entry of each cell while filling the buckets. */
+	std::vector<unsigned int> cursor[2];
+
+	int cellWidth(int c) const;
+	int cellHeight(int c) const;
+	unsigned long long distSqr(int x1, int y1, int x2, int y2) const;
+
+public:
+	SpatialGrid(void);
+
+	/** Rebuild the grid from a world snapshot. */
+	void rebuild(const DotStore::Buffer& dots, int w, int h);
+
+	/** Find the nearest non-busy dot of the given type. Ties are
+	 * broken by the lowest slot (and so by the lowest ID), just like a
+	 * full scan in ID order would.
+	 * \param x
+	 * \param y the position to search from
+	 * \param type the type of dot to look for
+	 * \param excluded slot of a dot which must never be returned
+	 * \return the dot's slot in the snapshot, or DotStore::NO_SLOT if
+	 * there is none
+	 */
+	unsigned int nearestOf(int x, int y, DotType type, unsigned int excluded) const;
+
+	/** Find the lowest-slot non-busy dot of the given type at exactly
+	 * the given position. Only the position's own cell is looked up.
+	 * \return the dot's slot, or DotStore::NO_SLOT if there is none
+	 */
+	unsigned int occupantAt(int x, int y, DotType type, unsigned int excluded) const;
+
+	/** \return the bytes held by the grid's tables */
+	size_t getMemoryUsage(void) const;
+};
+
+#endif
@@ -0,0 +1,134 @@
+/** \file StepProfile.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class StepProfile
+#include "StepProfile.h"
+
+using namespace std;
+
+StepProfile::Counts::Counts()
+:	dot_steps(0),
+	skipped(0),
+	density_evals(0),
+	density_skipped(0),
+	nearest_queries(0),
+	nearest_skipped(0),
+	births(0),
+	deaths(0),
+	density_seconds(0),
+	nearest_seconds(0)
+{
+}
+
+StepProfile::Counts& StepProfile::Counts::operator+=(const Counts& other)
+{
+	dot_steps += other.dot_steps;
+	skipped += other.skipped;
+	density_evals += other.density_evals;
+	density_skipped += other.density_skipped;
+	nearest_queries += other.nearest_queries;
+	nearest_skipped += other.nearest_skipped;
+	births += other.births;
+	deaths += other.deaths;
+	density_seconds += other.density_seconds;
+	nearest_seconds += other.nearest_seconds;
+	return *this;
+}
+
+StepProfile::StepProfile()
+:	steps(0),
+	has_counters(false),
+	counts()
+{
+	for (int p = 0 ; p < N_PHASES ; p++) {
+		seconds[p] = 0;
+		for (int c = 0 ; c < N_COUNTERS ; c++)
+			counters[p][c] = 0;
+	}
+}
+
+double StepProfile::totalSeconds(void) const
+{
+	double total = 0;
+	for (int p = 0 ; p < N_PHASES ; p++)
+		total += seconds[p];
+	return total;
+}
+
+const char* StepProfile::phaseName(Phase phase)
+{
+	switch (phase) {
+	case Phase::PHASE_PRUNE:	return "prune";
+	case Phase::PHASE_INDEX:	return "index";
+	case Phase::PHASE_DENSITY:	return "density";
+	case Phase::PHASE_DOTS:		return "dots";
+	case Phase::PHASE_BIRTHS:	return "births";
+	case Phase::PHASE_SWAP:		return "swap";
+	}
+	return "?";
+}
+
+const char* StepProfile::counterName(Counter counter)
+{
+	switch (counter) {
+	case Counter::COUNTER_CYCLES:			return "cycles";
+	case Counter::COUNTER_INSTRUCTIONS:		return "instructions";
+	case Counter::COUNTER_CACHE_MISSES:		return "cache_misses";
+	case Counter::COUNTER_BRANCH_MISSES:	return "branch_misses";
+	}
+	return "?";
+}
+
+void StepProfile::writeJson(ostream& out) const
+{
+	out << "{\"steps\": " << steps << ", \"phases\": {";
+	for (int p = 0 ; p < N_PHASES ; p++) {
+		out << (p > 0 ? ", " : "") << '"' << phaseName(static_cast<Phase>(p))
+			<< "\": {\"seconds\": " << seconds[p];
+		if (has_counters) {
+			for (int c = 0 ; c < N_COUNTERS ; c++)
+				out << ", \"" << counterName(static_cast<Counter>(c)) << "\": " << counters[p][c];
+		}
+		out << '}';
+	}
+	out << "}, \"counts\": {"
+		<< "\"dot_steps\": " << counts.dot_steps
+		<< ", \"skipped\": " << counts.skipped
+		<< ", \"density_evals\": " << counts.density_evals
+		<< ", \"density_skipped\": " << counts.density_skipped
+		<< ", \"nearest_queries\": " << counts.nearest_queries
+		<< ", \"nearest_skipped\": " << counts.nearest_skipped
+		<< ", \"births\": " << counts.births
+		<< ", \"deaths\": " << counts.deaths
+		<< ", \"density_seconds\": " << counts.density_seconds
+		<< ", \"nearest_seconds\": " << counts.nearest_seconds
+		<< "}}";
+}
+
+void StepProfile::dump(ostream& out, unsigned int frame) const
+{
+	out << "{\"frame\": " << frame << ", \"profile\": ";
+	writeJson(out);
+	out << '}' << endl;
+}
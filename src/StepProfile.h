@@ -0,0 +1,134 @@
+/** \file StepProfile.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef StepProfile_H
+#define StepProfile_H
+
+#include <chrono>
+#include <ostream>
+
+/** Where the time of Simulator::step() goes.
+ * Phases are the consecutive parts of a step, timed on the thread calling
+ * step(), along with hardware counters where the system lets us read them
+ * (see PerfCounters). Density and nearest dot lookups are counted and
+ * timed around every call instead, on whichever thread makes it: in
+ * STEP_PARALLEL mode their times add up those of every thread.
+ *
+ * Building with DOTS_NO_PROFILE takes all of it out of the simulator,
+ * profiles then staying empty.
+ */
+struct StepProfile
+{
+	enum class Phase : int
+	{
+		PHASE_PRUNE,		// removing the dead dots
+		PHASE_INDEX,		// rebuilding the bucket grid over the snapshot
+		PHASE_DENSITY,		// preparing the density engine
+		PHASE_DOTS,			// stepping every dot
+		PHASE_BIRTHS,		// newborns and statistics after a parallel phase
+		PHASE_SWAP			// publishing the new frame
+	};
+	static constexpr int N_PHASES = 6;
+
+	enum class Counter : int
+	{
+		COUNTER_CYCLES,
+		COUNTER_INSTRUCTIONS,
+		COUNTER_CACHE_MISSES,
+		COUNTER_BRANCH_MISSES
+	};
+	static constexpr int N_COUNTERS = 4;
+
+	/** What happened to the dots, from any thread. */
+	struct Counts
+	{
+		Counts();
+		Counts& operator+=(const Counts& other);
+
+		unsigned long long dot_steps;
+		/** Dot steps without a roll: waiting for an event
+		 * (SCHEDULE_EVENTS), or with no status to draw
+		 * (SCHEDULE_LIFETIMES) */
+		unsigned long long skipped;
+		unsigned long long density_evals;
+		/** Rolls made without the density, and dot steps without a
+		 * nearest dot query, their status not reading them */
+		unsigned long long density_skipped;
+		unsigned long long nearest_queries;
+		unsigned long long nearest_skipped;
+		unsigned long long births;
+		unsigned long long deaths;
+		double density_seconds;
+		double nearest_seconds;
+	};
+
+	/** Counts a lookup, and adds up its time when given somewhere to. */
+	class Stopwatch
+	{
+	private:
+		double* p_seconds;
+		std::chrono::steady_clock::time_point start;
+	public:
+		Stopwatch(unsigned long long& count, double* p_seconds);
+		~Stopwatch();
+	};
+
+	StepProfile();
+
+	unsigned long long steps;
+	double seconds[N_PHASES];
+	/** Hardware counters by phase, only valid with has_counters */
+	unsigned long long counters[N_PHASES][N_COUNTERS];
+	bool has_counters;
+	Counts counts;
+
+	/** Wall time of every phase together. */
+	double totalSeconds(void) const;
+
+	static const char* phaseName(Phase phase);
+	static const char* counterName(Counter counter);
+
+	/** Write the profile as a JSON object, on a single line. Hardware
+	 * counters are left out when there are none. */
+	void writeJson(std::ostream& out) const;
+	/** Write a line of JSON with the frame number and the profile. */
+	void dump(std::ostream& out, unsigned int frame) const;
+};
+
+inline StepProfile::Stopwatch::Stopwatch(unsigned long long& count, double* p_seconds)
+:	p_seconds(p_seconds),
+	start()
+{
+	count++;
+	if (p_seconds)
+		start = std::chrono::steady_clock::now();
+}
+
+inline StepProfile::Stopwatch::~Stopwatch()
+{
+	if (p_seconds)
+		*p_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif
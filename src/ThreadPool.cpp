@@ -0,0 +1,134 @@
+/** \file ThreadPool.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class ThreadPool
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+
+constexpr unsigned int ThreadPool::MAX_THREADS;
+
+ThreadPool::ThreadPool(unsigned int nthreads)
+:	workers(),
+	mutex(),
+	wake(),
+	done(),
+	p_body(nullptr),
+	job_last(0),
+	chunk(1),
+	next(0),
+	generation(0),
+	busy(0),
+	quitting(false)
+{
+	if (nthreads == 0)
+		nthreads = max(1u, thread::hardware_concurrency());
+	nthreads = min(nthreads, MAX_THREADS);
+
+	for (unsigned int t = 1 ; t < nthreads ; t++)
+		workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<std::mutex> lock(mutex);
+		quitting = true;
+	}
+	wake.notify_all();
+	for (thread& t : workers)
+		t.join();
+}
+
+unsigned int ThreadPool::size(void) const
+{
+	return workers.size() + 1;
+}
+
+void ThreadPool::runChunks(void)
+{
+	for (;;) {
+		const unsigned int first = next.fetch_add(chunk);
+		if (first >= job_last)
+			break;
+		(*p_body)(first, min(job_last, first + chunk));
+	}
+}
+
+void ThreadPool::work(void)
+{
+	unsigned long seen = 0;
+	for (;;) {
+		{
+			unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quitting || generation != seen; });
+			if (quitting)
+				return;
+			seen = generation;
+		}
+
+		runChunks();
+
+		{
+			lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0)
+				done.notify_one();
+		}
+	}
+}
+
+void ThreadPool::run(unsigned int first, unsigned int last, const Body& body, unsigned int grain)
+{
+	if (first >= last)
+		return;
+
+	// a few chunks per thread, to even out uneven loop bodies
+	const unsigned int count = last - first;
+	const unsigned int nchunk = (grain > 0) ? (count + grain - 1) / grain
+			: max(1u, min(count / 64, size() * 8));
+	const unsigned int csize = (count + nchunk - 1) / nchunk;
+
+	if (workers.empty() || nchunk == 1) {
+		body(first, last);
+		return;
+	}
+
+	{
+		lock_guard<std::mutex> lock(mutex);
+		p_body = &body;
+		job_last = last;
+		chunk = csize;
+		next.store(first);
+		busy = workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	runChunks();
+
+	unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&] { return busy == 0; });
+	p_body = nullptr;
+}
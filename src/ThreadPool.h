@@ -0,0 +1,99 @@
+/** \file ThreadPool.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef ThreadPool_H
+#define ThreadPool_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Fixed set of worker threads running loops over index ranges.
+ * Ranges are cut into chunks which the workers (and the calling thread)
+ * claim in turns from one shared atomic counter, so a loop body must not
+ * depend on which thread runs which index.
+ *
+ * This is a shared counter, not work stealing: there are no per-thread
+ * queues, and a claimed chunk is never taken over by an idle thread. A
+ * loop lasts at least as long as its slowest chunk, so uneven bodies
+ * need several chunks per thread; and every claim is an atomic increment
+ * of the same counter, which contends once chunks get very short.
+ */
+class ThreadPool
+{
+public:
+	/** Most threads a pool may be started with. */
+	static constexpr unsigned int MAX_THREADS = 1024;
+
+	/** Loop body, called with a chunk [first, last) of the range. */
+	using Body = std::function<void(unsigned int first, unsigned int last)>;
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	/** Current job, valid while <tt>busy</tt> is non-zero */
+	const Body* p_body;
+	unsigned int job_last;
+	unsigned int chunk;
+	std::atomic<unsigned int> next;
+
+	/** Bumped for every job, so that workers tell them apart */
+	unsigned long generation;
+	/** Workers still on the current job */
+	unsigned int busy;
+	bool quitting;
+
+	void work(void);
+	void runChunks(void);
+
+public:
+	/** Start the pool.
+	 * \param nthreads total number of threads, the caller's included;
+	 * 0 for one per hardware thread, at most MAX_THREADS
+	 */
+	explicit ThreadPool(unsigned int nthreads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/** Number of threads taking part in a loop, the caller's included. */
+	unsigned int size(void) const;
+
+	/** Run a body over [first, last) and wait for it to finish.
+	 * \param grain indices per chunk, 0 to cut the range into a few
+	 * chunks per thread; long loop bodies, such as whole simulations,
+	 * are best taken one at a time
+	 */
+	void run(unsigned int first, unsigned int last, const Body& body, unsigned int grain = 0);
+};
+
+#endif
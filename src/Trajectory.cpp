@@ -0,0 +1,509 @@
+/** \file Trajectory.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//namespace Trajectory
+#include "Trajectory.h"
+#include <cerrno>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+	const char MAGIC[8] = { 'D', 'O', 'T', 'S', 'T', 'R', 'A', 'J' };
+
+	/** A dot's status and type make a symbol. A dot found in the previous
+	 * block adds its move to it: (dx+1)*3 + (dy+1) for a move of at most
+	 * one position along each axis, which leaves a single byte for every
+	 * random walk step, or ESCAPE_MOVE followed by the move. */
+	constexpr unsigned int SYMBOL_BITS = 4;
+	constexpr unsigned int ESCAPE_MOVE = 9;
+
+	/** Varints longer than this are damaged. */
+	constexpr unsigned int MAX_VARINT_BYTES = 10;
+
+	void putVarint(vector<unsigned char>& out, unsigned long long v)
+	{
+		while (v >= 0x80) {
+			out.push_back((unsigned char)(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back((unsigned char)v);
+	}
+
+	void putSigned(vector<unsigned char>& out, long long v)
+	{
+		putVarint(out, ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+	}
+
+	/** Reads the varints of a block, failing past its end. */
+	struct Cursor
+	{
+		const unsigned char* p;
+		const unsigned char* end;
+		bool ok;
+
+		unsigned long long varint(void)
+		{
+			unsigned long long v = 0;
+			for (unsigned int shift = 0 ; shift < 7 * MAX_VARINT_BYTES ; shift += 7) {
+				if (p == end)
+					break;
+				const unsigned char byte = *p++;
+				v |= (unsigned long long)(byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return v;
+			}
+			ok = false;
+			return 0;
+		}
+
+		long long signedVarint(void)
+		{
+			const unsigned long long v = varint();
+			return (long long)(v >> 1) ^ -(long long)(v & 1);
+		}
+	};
+
+	unsigned int symbol(DotStatus status, DotType type)
+	{
+		return (unsigned int)(status + 1) | (type == DotType::DOT_BETA ? 1u << (SYMBOL_BITS - 1) : 0u);
+	}
+
+	/** Shortest offset from a to b, across the edge of the world or not */
+	int wrapDelta(int a, int b, int size)
+	{
+		int d = b - a;
+		if (d > size / 2)
+			d -= size;
+		else if (d < -(size / 2))
+			d += size;
+		return d;
+	}
+
+	int wrap(long long v, int size)
+	{
+		v %= size;
+		return (int)(v < 0 ? v + size : v);
+	}
+}
+
+Trajectory::Writer::Writer(void)
+:	grid_w(1),
+	grid_h(1),
+	keyframe_period(64),
+	max_buffered(64 << 20),
+	since_keyframe(0),
+	stalls(0),
+	bytes(0),
+	prev_id(),
+	prev_x(),
+	prev_y(),
+	block(),
+	file(nullptr),
+	thread(),
+	lock(),
+	wake(),
+	filling(),
+	writing(),
+	pending(false),
+	closing(false),
+	failed(false)
+{
+}
+
+Trajectory::Writer::~Writer()
+{
+	ostream nowhere(nullptr);
+	close(nowhere);
+}
+
+bool Trajectory::Writer::open(const string& filename, int w, int h, ostream& log,
+		unsigned int keyframe_period, size_t max_buffered)
+{
+	if (file) {
+		log << "A recording is already open" << endl;
+		return false;
+	}
+	file = fopen(filename.c_str(), "wb");
+	if (!file) {
+		log << "Cannot create " << filename << ": " << strerror(errno) << endl;
+		return false;
+	}
+
+	this->grid_w = w;
+	this->grid_h = h;
+	this->keyframe_period = (keyframe_period > 0) ? keyframe_period : 1;
+	this->max_buffered = max_buffered;
+	since_keyframe = 0;
+	stalls = 0;
+	bytes = 0;
+	prev_id.clear();
+	prev_x.clear();
+	prev_y.clear();
+	pending = false;
+	closing = false;
+	failed = false;
+
+	filling.assign(MAGIC, MAGIC + sizeof(MAGIC));
+	putVarint(filling, FORMAT_VERSION);
+	putVarint(filling, grid_w);
+	putVarint(filling, grid_h);
+	bytes = filling.size();
+
+	thread = std::thread(&Writer::run, this);
+	return true;
+}
+
+void Trajectory::Writer::write(unsigned int frame, const DotStore::Buffer& dots)
+{
+	if (!file)
+		return;
+
+	// the block goes after its size, once known
+	const size_t start = filling.size();
+	const bool keyframe = (since_keyframe == 0);
+	block.clear();
+	putVarint(block, frame);
+	putVarint(block, keyframe ? 1 : 0);
+	putVarint(block, dots.size());
+
+	size_t p = 0;
+	for (unsigned int i = 0 ; i < dots.size() ; i++) {
+		const DotId id = dots.id[i];
+		putVarint(block, (i == 0) ? id : id - dots.id[i - 1] - 1);
+		const unsigned int sym = symbol(dots.status[i], dots.type[i]);
+
+		// same dot in the previous block, both being in ID order
+		while (p < prev_id.size() && prev_id[p] < id)
+			p++;
+		if (!keyframe && p < prev_id.size() && prev_id[p] == id) {
+			const int dx = wrapDelta(prev_x[p], dots.x[i], grid_w);
+			const int dy = wrapDelta(prev_y[p], dots.y[i], grid_h);
+			if (dx >= -1 && dx <= 1 && dy >= -1 && dy <= 1)
+				putVarint(block, sym | (unsigned int)((dx + 1) * 3 + dy + 1) << SYMBOL_BITS);
+			else {
+				putVarint(block, sym | ESCAPE_MOVE << SYMBOL_BITS);
+				putSigned(block, dx);
+				putSigned(block, dy);
+			}
+		} else {
+			putVarint(block, sym);
+			putVarint(block, dots.x[i]);
+			putVarint(block, dots.y[i]);
+		}
+	}
+
+	putVarint(filling, block.size());
+	filling.insert(filling.end(), block.begin(), block.end());
+	bytes += filling.size() - start;
+
+	prev_id.assign(dots.id.begin(), dots.id.end());
+	prev_x.assign(dots.x.begin(), dots.x.end());
+	prev_y.assign(dots.y.begin(), dots.y.end());
+	since_keyframe = (since_keyframe + 1) % keyframe_period;
+
+	handOver(false);
+}
+
+void Trajectory::Writer::handOver(bool wait)
+{
+	unique_lock<mutex> guard(lock);
+	if (pending) {
+		if (!wait && filling.size() < max_buffered)
+			return;
+		// the disk is behind
+		if (!wait)
+			stalls++;
+		wake.wait(guard, [this]() { return !pending; });
+	}
+	swap(filling, writing);
+	filling.clear();
+	pending = true;
+	wake.notify_all();
+}
+
+void Trajectory::Writer::run(void)
+{
+	unique_lock<mutex> guard(lock);
+	while (true) {
+		wake.wait(guard, [this]() { return pending || closing; });
+		if (!pending)
+			break;
+
+		// the step loop keeps off the buffer being written
+		guard.unlock();
+		const bool ok = writing.empty()
+				|| fwrite(writing.data(), 1, writing.size(), file) == writing.size();
+		guard.lock();
+
+		failed = failed || !ok;
+		pending = false;
+		wake.notify_all();
+	}
+}
+
+bool Trajectory::Writer::close(ostream& log)
+{
+	if (!file)
+		return true;
+
+	handOver(true);
+	{
+		lock_guard<mutex> guard(lock);
+		closing = true;
+		wake.notify_all();
+	}
+	thread.join();
+
+	bool ok = !failed;
+	if (fclose(file) != 0)
+		ok = false;
+	file = nullptr;
+	if (!ok)
+		log << "Cannot write the recording: " << strerror(errno) << endl;
+	return ok;
+}
+
+unsigned long long Trajectory::Writer::getStalls(void) const
+{
+	return stalls;
+}
+
+unsigned long long Trajectory::Writer::getBytes(void) const
+{
+	return bytes;
+}
+
+Trajectory::Frame::Frame(void)
+:	frame(0),
+	id(),
+	x(),
+	y(),
+	status(),
+	type()
+{
+}
+
+unsigned int Trajectory::Frame::size(void) const
+{
+	return id.size();
+}
+
+Trajectory::Reader::Reader(void)
+:	input(),
+	grid_w(1),
+	grid_h(1),
+	blocks(),
+	current(),
+	current_block(0),
+	decoded(),
+	payload()
+{
+}
+
+bool Trajectory::Reader::open(const string& filename, ostream& log)
+{
+	input.close();
+	input.clear();
+	blocks.clear();
+	current_block = 0;
+
+	input.open(filename, ios::binary);
+	if (!input) {
+		log << "Cannot open " << filename << endl;
+		return false;
+	}
+
+	// the header and each block's size are read a byte at a time
+	auto readVarint = [this](unsigned long long& v) {
+		v = 0;
+		for (unsigned int shift = 0 ; shift < 7 * MAX_VARINT_BYTES ; shift += 7) {
+			const int byte = input.get();
+			if (byte == EOF)
+				return false;
+			v |= (unsigned long long)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	};
+
+	char magic[sizeof(MAGIC)];
+	unsigned long long version = 0, w = 0, h = 0;
+	if (!input.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+			|| !readVarint(version)) {
+		log << filename << " is not a recording" << endl;
+		return false;
+	}
+	if (version != FORMAT_VERSION) {
+		log << filename << " has format version " << version
+			<< ", not " << FORMAT_VERSION << endl;
+		return false;
+	}
+	if (!readVarint(w) || !readVarint(h) || w == 0 || h == 0 || w > 1u << 30 || h > 1u << 30) {
+		log << filename << " is damaged" << endl;
+		return false;
+	}
+	grid_w = (int)w;
+	grid_h = (int)h;
+
+	input.seekg(0, ios::end);
+	const streamoff end = input.tellg();
+	input.seekg(sizeof(MAGIC));
+	readVarint(version);
+	readVarint(w);
+	readVarint(h);
+
+	while (true) {
+		unsigned long long size;
+		if (!readVarint(size))
+			break;
+		const streamoff offset = input.tellg();
+		if (size > (unsigned long long)(end - offset))
+			break;
+
+		// the frame number and kind start the block
+		unsigned long long frame = 0, keyframe = 0;
+		if (!readVarint(frame) || !readVarint(keyframe))
+			break;
+		if (blocks.empty() && !keyframe)
+			break;
+		blocks.push_back(Block { (unsigned int)frame, keyframe != 0, offset, (size_t)size });
+		input.seekg(offset + (streamoff)size);
+	}
+	input.clear();
+	current_block = blocks.size();
+	return true;
+}
+
+int Trajectory::Reader::getWidth(void) const
+{
+	return grid_w;
+}
+
+int Trajectory::Reader::getHeight(void) const
+{
+	return grid_h;
+}
+
+unsigned int Trajectory::Reader::size(void) const
+{
+	return blocks.size();
+}
+
+unsigned int Trajectory::Reader::frameNumber(unsigned int i) const
+{
+	return blocks[i].frame;
+}
+
+const Trajectory::Frame* Trajectory::Reader::read(unsigned int i)
+{
+	if (i >= blocks.size())
+		return nullptr;
+	if (i == current_block)
+		return &current;
+
+	// forward from the current frame when no keyframe lies in between,
+	// from the closest keyframe otherwise
+	size_t key = i;
+	while (!blocks[key].keyframe)
+		key--;
+	size_t b = (current_block < i && current_block >= key) ? current_block + 1 : key;
+
+	for ( ; b <= i ; b++) {
+		if (!decode(b)) {
+			current_block = blocks.size();
+			return nullptr;
+		}
+	}
+	return &current;
+}
+
+bool Trajectory::Reader::decode(size_t b)
+{
+	const Block& block = blocks[b];
+	payload.resize(block.size);
+	input.clear();
+	input.seekg(block.offset);
+	if (!input.read(reinterpret_cast<char*>(payload.data()), payload.size()))
+		return false;
+
+	Cursor in { payload.data(), payload.data() + payload.size(), true };
+	decoded.frame = (unsigned int)in.varint();
+	const bool keyframe = (in.varint() != 0);
+	const unsigned long long n = in.varint();
+	// every dot takes two bytes at least
+	if (!in.ok || n > payload.size() / 2)
+		return false;
+
+	decoded.id.resize(n);
+	decoded.x.resize(n);
+	decoded.y.resize(n);
+	decoded.status.resize(n);
+	decoded.type.resize(n);
+
+	size_t p = 0;
+	unsigned long long id = 0;
+	for (size_t i = 0 ; i < n && in.ok ; i++) {
+		id = (i == 0) ? in.varint() : id + in.varint() + 1;
+		const unsigned long long code = in.varint();
+		const unsigned int sym = code & ((1u << SYMBOL_BITS) - 1);
+		const unsigned long long move = code >> SYMBOL_BITS;
+
+		while (p < current.size() && current.id[p] < id)
+			p++;
+		if (!keyframe && p < current.size() && current.id[p] == id) {
+			long long dx, dy;
+			if (move == ESCAPE_MOVE) {
+				dx = in.signedVarint();
+				dy = in.signedVarint();
+			} else if (move < ESCAPE_MOVE) {
+				dx = (long long)(move / 3) - 1;
+				dy = (long long)(move % 3) - 1;
+			} else
+				return false;
+			decoded.x[i] = wrap(current.x[p] + dx, grid_w);
+			decoded.y[i] = wrap(current.y[p] + dy, grid_h);
+		} else {
+			if (move != 0)
+				return false;
+			decoded.x[i] = wrap(in.varint(), grid_w);
+			decoded.y[i] = wrap(in.varint(), grid_h);
+		}
+
+		const int status = (int)(sym & ((1u << (SYMBOL_BITS - 1)) - 1)) - 1;
+		if (status > STATUS_GENERATING)
+			return false;
+		decoded.id[i] = id;
+		decoded.status[i] = static_cast<DotStatus>(status);
+		decoded.type[i] = (sym >> (SYMBOL_BITS - 1)) ? DotType::DOT_BETA : DotType::DOT_ALPHA;
+	}
+	if (!in.ok)
+		return false;
+
+	swap(current, decoded);
+	current_block = b;
+	return true;
+}
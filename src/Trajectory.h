@@ -0,0 +1,196 @@
+/** \file Trajectory.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef Trajectory_H
+#define Trajectory_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Dot.h"
+#include "DotStore.h"
+
+/** Recordings of dot trajectories: the ID, position, status and type of
+ * every dot, frame after frame.
+ * A recording starts with a header (magic string, format version, world
+ * size), followed by a block per recorded frame: its size, the frame
+ * number, whether it is a keyframe, and the dots in ID order. Numbers are
+ * stored as varints, signed ones zigzag encoded. Keyframes hold absolute
+ * positions. Other blocks hold, for dots which were already in the
+ * previous block, their move since then, which is a single byte for the
+ * usual step of at most one position; IDs are stored as the gap from the
+ * previous dot's.
+ */
+namespace Trajectory
+{
+	/** Version of the format, to be raised with any change to it. */
+	constexpr unsigned int FORMAT_VERSION = 1;
+
+	/** Records frames as they are stepped. Frames are encoded on the
+	 * calling thread, then written to disk by a thread of the writer's
+	 * own, through a pair of buffers: one being filled while the other is
+	 * written. The step loop only waits for the disk when the buffer being
+	 * filled outgrows its bound, which is counted as a stall.
+	 */
+	class Writer
+	{
+	private:
+		int grid_w;
+		int grid_h;
+		unsigned int keyframe_period;
+		size_t max_buffered;
+		/** Blocks recorded since the last keyframe */
+		unsigned int since_keyframe;
+		unsigned long long stalls;
+		unsigned long long bytes;
+
+		/** The previous block's dots, which moves are relative to */
+		std::vector<DotId> prev_id;
+		std::vector<int> prev_x;
+		std::vector<int> prev_y;
+		/** The block being encoded */
+		std::vector<unsigned char> block;
+
+		FILE* file;
+		std::thread thread;
+		std::mutex lock;
+		std::condition_variable wake;
+		/** Encoded blocks, being filled and being written */
+		std::vector<unsigned char> filling;
+		std::vector<unsigned char> writing;
+		/** Whether <tt>writing</tt> holds blocks the thread has to write */
+		bool pending;
+		bool closing;
+		/** Whether a write failed, on the writer's thread */
+		bool failed;
+
+		void run(void);
+		/** Hand the filled buffer over to the thread, waiting for it if
+		 * <tt>wait</tt> or if the buffer is full. */
+		void handOver(bool wait);
+
+	public:
+		Writer(void);
+		~Writer();
+
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+
+		/** Create a recording, and start the writer's thread.
+		 * \param keyframe_period blocks from one keyframe to the next
+		 * \param max_buffered bytes of encoded frames which may wait for
+		 * the disk before the step loop does
+		 * \param log where errors are reported
+		 */
+		bool open(const std::string& filename, int w, int h, std::ostream& log,
+				unsigned int keyframe_period = 64, size_t max_buffered = 64 << 20);
+
+		/** Record the dots of a frame, which must not be under way. */
+		void write(unsigned int frame, const DotStore::Buffer& dots);
+
+		/** Write what is left and close the recording.
+		 * \return false if anything could not be written
+		 */
+		bool close(std::ostream& log);
+
+		/** \return how many times write() had to wait for the disk */
+		unsigned long long getStalls(void) const;
+		/** \return bytes recorded so far, header included */
+		unsigned long long getBytes(void) const;
+	};
+
+	/** The dots of a recorded frame, by ID. */
+	struct Frame
+	{
+		Frame(void);
+
+		unsigned int frame;
+		std::vector<DotId> id;
+		std::vector<int> x;
+		std::vector<int> y;
+		std::vector<DotStatus> status;
+		std::vector<DotType> type;
+
+		unsigned int size(void) const;
+	};
+
+	/** Reads the frames of a recording in any order. Opening indexes
+	 * every block; each read then decodes from the current frame when
+	 * going forward, from the closest keyframe otherwise.
+	 */
+	class Reader
+	{
+	private:
+		struct Block
+		{
+			unsigned int frame;
+			bool keyframe;
+			std::streamoff offset;
+			size_t size;
+		};
+
+		std::ifstream input;
+		int grid_w;
+		int grid_h;
+		std::vector<Block> blocks;
+
+		/** The decoded frame, and its block (blocks.size() for none) */
+		Frame current;
+		size_t current_block;
+		Frame decoded;
+		std::vector<unsigned char> payload;
+
+		bool decode(size_t b);
+
+	public:
+		Reader(void);
+
+		/** Open a recording and index its blocks. A block cut short, as
+		 * left by an interrupted run, ends the recording.
+		 * \param log where errors are reported
+		 */
+		bool open(const std::string& filename, std::ostream& log);
+
+		int getWidth(void) const;
+		int getHeight(void) const;
+
+		/** \return the number of recorded frames */
+		unsigned int size(void) const;
+		/** \return the frame number of the i-th recorded frame */
+		unsigned int frameNumber(unsigned int i) const;
+
+		/** Decode the i-th recorded frame.
+		 * \return the frame, valid until the next read, or nullptr if it
+		 * cannot be decoded
+		 */
+		const Frame* read(unsigned int i);
+	};
+}
+
+#endif
@@ -0,0 +1,204 @@
+/** \file TransitionTable.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+//Class TransitionTable
+#include "TransitionTable.h"
+#include "RandGenerator.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+constexpr int TransitionTable::N_STATUSES;
+constexpr unsigned int TransitionTable::MAX_AGES;
+
+/** Rows of normal and hungry dots, see sample() */
+static constexpr int NORMAL = 0;
+static constexpr int HUNGRY = 2;
+/** Row of eating dots, which may only die or keep eating */
+static constexpr int EATING = 4;
+
+TransitionTable::TransitionTable(void)
+:	n_ages(0),
+	cdfs(),
+	living_cdfs(),
+	log_survival(),
+	hunger_chance(0),
+	death_chance_maj(1)
+{
+}
+
+void TransitionTable::build(double hunger_chance, double death_chance_maj, const GaussFunc& look_prob)
+{
+	this->hunger_chance = hunger_chance;
+	this->death_chance_maj = death_chance_maj;
+
+	// death is certain from death_chance_maj on
+	n_ages = (death_chance_maj > 0) ? (unsigned int)death_chance_maj + 1 : 1;
+	cdfs.resize((size_t)N_STATUSES * n_ages * N_STATUSES);
+	for (int s = 0 ; s < N_STATUSES ; s++) {
+		for (unsigned int age = 0 ; age < n_ages ; age++)
+			compute(s, age, 0, look_prob.getPDF(age), &cdfs[((size_t)s * n_ages + age) * N_STATUSES]);
+	}
+	living_cdfs.resize((size_t)n_ages * N_STATUSES);
+	for (unsigned int age = 0 ; age < n_ages ; age++)
+		compute(NORMAL, age, 0, look_prob.getPDF(age), &living_cdfs[(size_t)age * N_STATUSES], true);
+
+	// the death chance of an eating dot, with nothing before it in the CDF
+	log_survival.resize(n_ages + 1);
+	log_survival[0] = 0;
+	for (unsigned int age = 0 ; age < n_ages ; age++) {
+		const double death = cdfs[((size_t)EATING * n_ages + age) * N_STATUSES + 1];
+		log_survival[age + 1] = log_survival[age] + log(max(0.0, 1 - death));
+	}
+}
+
+unsigned int TransitionTable::size(void) const
+{
+	return n_ages;
+}
+
+int TransitionTable::sample(int status, unsigned int age, double pdensity, double u) const
+{
+	double cdf[N_STATUSES];
+	const double* row;
+	if (age >= n_ages || status < 0 || status >= N_STATUSES) {
+		compute(status, age, pdensity, 0, cdf);
+		row = cdf;
+	} else if (status == HUNGRY) {
+		// dying, staying hungry or eating; the same sums as compute()
+		const double death = cdfs[((size_t)HUNGRY * n_ages + age) * N_STATUSES + 1];
+		const double eating = (1 - death) * (1 / (pdensity + 1));
+		const double hungry = 1 - death - eating;
+		cdf[0] = 0;
+		cdf[1] = death;
+		cdf[2] = cdf[1] + hungry;
+		cdf[3] = cdf[2];
+		cdf[4] = cdf[3] + eating;
+		cdf[5] = cdf[4];
+		row = cdf;
+	} else
+		row = &cdfs[((size_t)status * n_ages + age) * N_STATUSES];
+
+	return RandGenerator::genvar(row, N_STATUSES, u);
+}
+
+int TransitionTable::sampleLiving(int status, unsigned int age, double pdensity, double u) const
+{
+	double cdf[N_STATUSES];
+	const double* row;
+	if (status == HUNGRY) {
+		const double eating = 1 / (pdensity + 1);
+		cdf[0] = 0;
+		cdf[1] = 0;
+		cdf[2] = 1 - eating;
+		cdf[3] = cdf[2];
+		cdf[4] = 1;
+		cdf[5] = 1;
+		row = cdf;
+	} else if (status != NORMAL)
+		return status;
+	else if (age >= n_ages) {
+		compute(status, age, pdensity, 0, cdf, true);
+		row = cdf;
+	} else
+		row = &living_cdfs[(size_t)age * N_STATUSES];
+
+	return RandGenerator::genvar(row, N_STATUSES, u);
+}
+
+bool TransitionTable::readsDensity(int status)
+{
+	return status == HUNGRY;
+}
+
+void TransitionTable::getCDF(int status, unsigned int age, double pdensity, double* cdf) const
+{
+	if (age >= n_ages || status < 0 || status >= N_STATUSES || status == HUNGRY)
+		compute(status, age, pdensity, 0, cdf);
+	else {
+		const double* row = &cdfs[((size_t)status * n_ages + age) * N_STATUSES];
+		copy(row, row + N_STATUSES, cdf);
+	}
+}
+
+void TransitionTable::compute(int status, unsigned int age, double pdensity, double look_chance,
+		double* cdf, bool survives) const
+{
+	double pdf[N_STATUSES] = { 0, 0, 0, 0, 0, 0 };
+
+	//death - 1
+	pdf[1] = (double)age/death_chance_maj;
+	pdf[1] *= pdf[1]; //squared
+	if (survives)
+		pdf[1] = 0;
+
+	switch (status)
+	{
+	case 0:		// STATUS_NORMAL
+		//hungry - 2
+		pdf[2] = (1-pdf[1]) * hunger_chance;
+
+		//looking - 3
+		pdf[3] = (1-pdf[1]-pdf[2]) * look_chance;
+
+		//normal - 0
+		pdf[0] = 1 - pdf[1] - pdf[2] - pdf[3];
+	break;
+	case 2:		// STATUS_HUNGRY
+		//eating - 4
+		pdf[4] = (1 - pdf[1]) * (1 / (pdensity + 1));
+
+		//hungry - 2
+		pdf[2] = 1 - pdf[1] - pdf[4];
+	break;
+	case 3:		// STATUS_LOOKING, generating is procedural
+		pdf[3] = 1 - pdf[1];
+	break;
+	case 4:		// STATUS_EATING, back to normal is procedural
+		pdf[4] = 1 - pdf[1];
+	break;
+	case 5:		// STATUS_GENERATING, back to normal is procedural
+		pdf[5] = 1 - pdf[1];
+	break;
+	default:
+	break;
+	}
+
+	RandGenerator::pdf2cdf(pdf, cdf, N_STATUSES);
+}
+
+unsigned int TransitionTable::deathAge(unsigned int age, double u) const
+{
+	// death is certain past the table
+	if (age >= n_ages)
+		return age;
+
+	// the first age whose survival, from age on, falls below u
+	const double threshold = log_survival[age] + log(u);
+	auto first = log_survival.begin() + age + 1;
+	auto found = partition_point(first, log_survival.end(),
+			[threshold](double s) { return s >= threshold; });
+	return age + (unsigned int)(found - first);
+}
@@ -0,0 +1,120 @@
+/** \file TransitionTable.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef TransitionTable_H
+#define TransitionTable_H
+
+#include <vector>
+#include "GaussFunc.h"
+
+/** Status transition chances of the dots, computed once per configuration.
+ * A dot's next status only depends on its current status and its age,
+ * except for a hungry dot, whose chance of eating also depends on the
+ * population density around it. The table holds the CDF over the six
+ * statuses for every (status, age) pair, up to the age where death is
+ * certain; hungry rows hold the density-free part, and the rest of the
+ * CDF is derived in closed form as the dot is sampled. Older dots, which
+ * are rare, have their CDF computed on the spot.
+ *
+ * Statuses are the DotStatus values, STATUS_NORMAL (0) to
+ * STATUS_GENERATING (5). Samples are exactly those of
+ * RandGenerator::genvar over the CDF of compute().
+ */
+class TransitionTable
+{
+public:
+	/** Number of dot statuses */
+	static constexpr int N_STATUSES = 6;
+	/** Most ages a table may cover, some 20 MB of CDFs; death_chance_maj
+	 * must stay below it */
+	static constexpr unsigned int MAX_AGES = 1 << 16;
+
+private:
+	/** Ages covered by the table, 0 to n_ages-1 */
+	unsigned int n_ages;
+	/** CDF of every status and age, indexed [status][age][next status] */
+	std::vector<double> cdfs;
+	/** CDF of a normal dot which survives the step, by age */
+	std::vector<double> living_cdfs;
+	/** Log of the chance of surviving every age below each age, from 0
+	 * to n_ages; the chance of dying at an age is the same in any status */
+	std::vector<double> log_survival;
+
+	double hunger_chance;
+	double death_chance_maj;
+
+	/** Compute the CDF of a dot's next status from scratch.
+	 * \param look_chance chance of looking at that age, for normal dots
+	 * \param cdf set to the N_STATUSES cumulative chances
+	 * \param survives whether the dot is known to survive the step, which
+	 * leaves the chances of the other statuses, in proportion
+	 */
+	void compute(int status, unsigned int age, double pdensity, double look_chance,
+			double* cdf, bool survives = false) const;
+
+public:
+	TransitionTable(void);
+
+	/** Rebuild the table.
+	 * \param look_prob chance of looking by age, from 0 to
+	 * death_chance_maj; none after that
+	 */
+	void build(double hunger_chance, double death_chance_maj, const GaussFunc& look_prob);
+
+	/** \return the number of ages covered by the table */
+	unsigned int size(void) const;
+
+	/** Draw the next status of a dot.
+	 * \param pdensity population density around the dot, only used for
+	 * hungry dots
+	 * \param u uniform random draw in [0,1]
+	 */
+	int sample(int status, unsigned int age, double pdensity, double u) const;
+
+	/** Draw the next status of a dot known to survive the step, its death
+	 * being drawn apart (see deathAge). Only normal and hungry dots may
+	 * change status, the others keep theirs without a draw.
+	 */
+	int sampleLiving(int status, unsigned int age, double pdensity, double u) const;
+
+	/** \return whether the next status of a dot in the given status
+	 * depends on the population density; sample() and sampleLiving() do
+	 * not read it otherwise */
+	static bool readsDensity(int status);
+
+	/** Get the CDF of a dot's next status.
+	 * \param cdf set to the N_STATUSES cumulative chances
+	 */
+	void getCDF(int status, unsigned int age, double pdensity, double* cdf) const;
+
+	/** Draw the age at which a dot dies, if it survives every status
+	 * change on the way: the first age, from <tt>age</tt> on, at which a
+	 * step kills it. Equivalent to rolling for death at every step, which
+	 * does not depend on the dot's status.
+	 * \param u uniform random draw in (0,1]
+	 */
+	unsigned int deathAge(unsigned int age, double u) const;
+};
+
+#endif
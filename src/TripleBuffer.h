@@ -0,0 +1,94 @@
+/** \file TripleBuffer.h
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef TripleBuffer_H
+#define TripleBuffer_H
+
+#include <atomic>
+
+/** Lock-free handoff of the latest value from one writer thread to one
+ * reader thread. Of three slots, the writer fills one, the reader holds
+ * another, and the third is the one last published. Publishing swaps the
+ * writer's slot with the published one, and taking the latest value
+ * swaps the reader's slot with it if it is newer: neither side ever
+ * waits for the other, and values the reader missed are simply dropped.
+ */
+template <typename T>
+class TripleBuffer
+{
+private:
+	/** Flag of the published slot, set while the reader has not taken it */
+	static constexpr unsigned int FRESH = 4;
+
+	T slots[3];
+	/** Index of the writer's slot, and of the reader's */
+	unsigned int back;
+	unsigned int front;
+	/** Index of the published slot, with FRESH */
+	std::atomic<unsigned int> middle;
+
+public:
+	TripleBuffer(void)
+	:	back(0),
+		front(1),
+		middle(2)
+	{
+	}
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	/** The writer's slot, to be filled before publish(). It may hold any
+	 * earlier value; reusing its storage is the point. */
+	T& writeSlot(void)
+	{
+		return slots[back];
+	}
+
+	/** Make the writer's slot the latest value (writer only). */
+	void publish(void)
+	{
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+	}
+
+	/** Take the latest value, if it was published since the last call
+	 * (reader only).
+	 * \return whether readSlot() changed
+	 */
+	bool update(void)
+	{
+		if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+		return true;
+	}
+
+	/** The reader's slot, unchanged until the next update(). */
+	const T& readSlot(void) const
+	{
+		return slots[front];
+	}
+};
+
+#endif
@@ -0,0 +1,219 @@
+/** \file batch.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <memory>
+#include "Configurator.h"
+#include "Simulator.h"
+
+/* Headless runs: no window, no GL, every step as fast as possible.
+ * Statistics go to the standard output as CSV, everything else to the
+ * standard error. */
+
+using namespace std;
+
+static void usage(const char* program)
+{
+	cerr << "Usage: " << program << " [options] [name=value ...]" << endl
+		<< "  -c FILE    config file (default " << CONFIG_FILENAME << ")" << endl
+		<< "  -n FRAMES  frames to run, 0 for no limit (default 1000)" << endl
+		<< "  -p FRAMES  print statistics every FRAMES frames, 0 for the last"
+		<< " frame only (default 100)" << endl
+		<< "  -q         do not echo the configuration" << endl
+		<< "  -r FILE    resume from a checkpoint instead of the config file" << endl
+		<< "  -s FILE    save a checkpoint whenever statistics are printed" << endl
+		<< "  -t FILE    record the dots' trajectories (see Trajectory)" << endl
+		<< "  -e FRAMES  record every FRAMES frames (default 1)" << endl
+		<< "  name=value override a setting of the config file, or an engine"
+		<< " option (see Configurator::assign)" << endl
+		<< "The run stops early when every dot is dead. Frames are counted from"
+		<< " the start of the simulation, resumed or not." << endl;
+}
+
+static bool parseCount(const char* text, unsigned long& value)
+{
+	char* end;
+	value = strtoul(text, &end, 10);
+	return *text != '\0' && *end == '\0';
+}
+
+static bool saveCheckpoint(const Simulator& sim, const string& filename)
+{
+	if (filename.empty())
+		return true;
+	if (!sim.save(filename, cerr)) {
+		cerr << "Program failed: Cannot save a checkpoint" << endl;
+		return false;
+	}
+	return true;
+}
+
+static void printStats(const Simulator& sim, double elapsed)
+{
+	cout << sim.getFrame() << ',' << sim.ndots() << ',' << sim.getNDeaths() << ',';
+	if (sim.getNDeaths() > 0)
+		cout << sim.getDeathAverage();
+	else
+		cout << "nan";
+	cout << ',' << sim.getMaxAge() << ',' << sim.getMaxDots() << ',' << elapsed << ',';
+	if (sim.ndots() > 0)
+		cout << (double)sim.getMemoryUsage() / sim.ndots() << endl;
+	else
+		cout << "nan" << endl;
+}
+
+int main(int argc, char** argv)
+{
+	string config = CONFIG_FILENAME;
+	unsigned long frames = 1000;
+	unsigned long period = 100;
+	bool quiet = false;
+	string resume;
+	string checkpoint;
+	string recording;
+	unsigned long record_period = 1;
+	Configurator::Settings settings;
+	vector<string> assignments;
+
+	for (int i = 1 ; i < argc ; i++) {
+		const string arg = argv[i];
+		if ((arg == "-c" || arg == "-n" || arg == "-p" || arg == "-r" || arg == "-s"
+				|| arg == "-t" || arg == "-e") && i + 1 >= argc) {
+			cerr << "Missing value after " << arg << endl;
+			return 2;
+		}
+
+		if (arg == "-c")
+			config = argv[++i];
+		else if (arg == "-n" && parseCount(argv[i + 1], frames))
+			i++;
+		else if (arg == "-p" && parseCount(argv[i + 1], period))
+			i++;
+		else if (arg == "-r")
+			resume = argv[++i];
+		else if (arg == "-s")
+			checkpoint = argv[++i];
+		else if (arg == "-t")
+			recording = argv[++i];
+		else if (arg == "-e" && parseCount(argv[i + 1], record_period) && record_period > 0)
+			i++;
+		else if (arg == "-q")
+			quiet = true;
+		else if (arg == "-h" || arg == "--help") {
+			usage(argv[0]);
+			return 0;
+		} else if (arg.find('=') != string::npos)
+			assignments.push_back(arg);	// applied once the file is read
+		else {
+			cerr << "Bad argument: " << arg << endl;
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	unique_ptr<Simulator> p_sim;
+	if (!resume.empty()) {
+		// everything comes from the checkpoint
+		if (!assignments.empty()) {
+			cerr << "Settings cannot be changed when resuming" << endl;
+			return 2;
+		}
+		if (!Simulator::restore(resume, p_sim, cerr)) {
+			cerr << "Program failed: Cannot resume from " << resume << endl;
+			return 1;
+		}
+		if (!quiet)
+			cerr << "Resuming at frame " << p_sim->getFrame() << endl;
+	} else {
+		ostream nowhere(nullptr);
+		if (!Configurator::read(config, settings, quiet ? nowhere : cerr)) {
+			cerr << "Program failed: Cannot read " << config << endl;
+			return 1;
+		}
+		for (const string& assignment : assignments) {
+			if (!Configurator::assign(settings, assignment)) {
+				cerr << "Bad setting: " << assignment << endl;
+				return 2;
+			}
+			if (!quiet)
+				cerr << "override " << assignment << endl;
+		}
+		Configurator::create(settings, p_sim);
+	}
+
+	Trajectory::Writer recorder;
+	if (!recording.empty()) {
+		if (!recorder.open(recording, p_sim->getWidth(), p_sim->getHeight(), cerr)) {
+			cerr << "Program failed: Cannot record to " << recording << endl;
+			return 1;
+		}
+		p_sim->record(recorder);
+	}
+
+	cout << "frame,ndots,deaths,death_average,max_age,max_dots,seconds,bytes_per_dot" << endl;
+
+	const auto start = chrono::steady_clock::now();
+	auto elapsed = [&start]() {
+		return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	};
+
+	if (period > 0)
+		printStats(*p_sim, 0);
+	while ((frames == 0 || p_sim->getFrame() < frames) && p_sim->ndots() > 0) {
+		p_sim->step();
+		if (!recording.empty() && p_sim->getFrame() % record_period == 0)
+			p_sim->record(recorder);
+		if (period > 0 && p_sim->getFrame() % period == 0) {
+			printStats(*p_sim, elapsed());
+			if (!saveCheckpoint(*p_sim, checkpoint))
+				return 1;
+		}
+	}
+	if (period == 0 || p_sim->getFrame() % period != 0) {
+		printStats(*p_sim, elapsed());
+		if (!saveCheckpoint(*p_sim, checkpoint))
+			return 1;
+	}
+
+	if (p_sim->ndots() == 0)
+		cerr << "All dots are dead at frame " << p_sim->getFrame() << endl;
+
+	if (!recording.empty()) {
+		if (!recorder.close(cerr)) {
+			cerr << "Program failed: Cannot record to " << recording << endl;
+			return 1;
+		}
+		if (!quiet)
+			cerr << "Recorded " << recorder.getBytes() << " bytes, waiting "
+				<< recorder.getStalls() << " times for the disk" << endl;
+	}
+
+	return 0;
+}
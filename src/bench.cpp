@@ -0,0 +1,360 @@
+/** \file bench.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memory>
+#include "Configurator.h"
+#include "PairKernels.h"
+#include "Simulator.h"
+
+/* Step timings over fixed scenarios, written as JSON so that runs of
+ * different versions can be compared. Every scenario has its own seed,
+ * and every run is made in a child process of its own, so that the peak
+ * RSS is that of the run alone. */
+
+using namespace std;
+
+struct Scenario
+{
+	const char* name;
+	int grid_w;
+	int grid_h;
+	int init_dots;
+	int rand_seed;
+	/** Changes to the default parameters (those of bin/config.txt) */
+	void (*tune)(DotConf& dotconf);
+};
+
+static void keepDefaults(DotConf&)
+{
+}
+
+static void tuneGrowth(DotConf& dotconf)
+{
+	// dots look for partners early and rarely die
+	dotconf.looking_chance_mean = 20.0;
+	dotconf.looking_chance_var = 10.0;
+	dotconf.death_chance_maj = 50000.0;
+	dotconf.generation_time = 2;
+}
+
+static void tuneExtinction(DotConf& dotconf)
+{
+	// dots starve and die long before they look for partners
+	dotconf.hunger_chance = 0.2;
+	dotconf.death_chance_maj = 300.0;
+}
+
+static const Scenario SCENARIOS[] = {
+	{ "sparse",		512,	512,	1000,	49209,	keepDefaults },
+	{ "dense",		96,		96,		4000,	49209,	keepDefaults },
+	{ "growth",		128,	128,	2000,	49209,	tuneGrowth },
+	{ "extinction",	128,	128,	2000,	49209,	tuneExtinction },
+	{ "grid-48",	48,		48,		36,		49209,	keepDefaults },
+	{ "grid-256",	256,	256,	1024,	49209,	keepDefaults },
+	{ "grid-1024",	1024,	1024,	16384,	49209,	keepDefaults },
+	{ "grid-4096",	4096,	4096,	16384,	49209,	keepDefaults }
+};
+static const size_t N_SCENARIOS = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+/** What a run measured. */
+struct Result
+{
+	unsigned int frames;
+	unsigned int dots_start;
+	unsigned int dots_end;
+	unsigned long long dot_steps;
+	double seconds;
+	long peak_rss_kb;
+	/** Memory held for the dots at the end, over the dots left */
+	double bytes_per_dot;
+	/** Timed frames by phase, when run with profile=1 */
+	StepProfile profile;
+};
+
+static string jsonString(const string& text)
+{
+	string out = "\"";
+	for (char c : text) {
+		if (c == '"' || c == '\\')
+			out += '\\';
+		if ((unsigned char)c < 0x20)
+			continue;
+		out += c;
+	}
+	return out + "\"";
+}
+
+static void usage(const char* program)
+{
+	cerr << "Usage: " << program << " [options] [name=value ...]" << endl
+		<< "  -s LIST    comma separated scenarios (default all):";
+	for (size_t i = 0 ; i < N_SCENARIOS ; i++)
+		cerr << ' ' << SCENARIOS[i].name;
+	cerr << endl
+		<< "  -n FRAMES  timed frames per run (default 30)" << endl
+		<< "  -w FRAMES  untimed frames before them (default 3)" << endl
+		<< "  -t LIST    comma separated thread counts, 0 for serial stepping"
+		<< " (default 0)" << endl
+		<< "  -o FILE    write the JSON report there instead of the standard output" << endl
+		<< "  name=value override a setting in every scenario"
+		<< " (see Configurator::assign);" << endl
+		<< "             profile=1 breaks the timed frames down by phase" << endl;
+}
+
+static bool splitList(const string& text, vector<string>& items)
+{
+	items.clear();
+	stringstream input(text);
+	string item;
+	while (getline(input, item, ','))
+		items.push_back(item);
+	return !items.empty();
+}
+
+static Result measure(const Scenario& scenario, const vector<string>& assignments,
+		unsigned int threads, unsigned int warmup, unsigned int frames)
+{
+	Configurator::Settings settings;
+	settings.rand_seed = scenario.rand_seed;
+	settings.grid_w = scenario.grid_w;
+	settings.grid_h = scenario.grid_h;
+	settings.init_dots = scenario.init_dots;
+	settings.dotconf.hunger_chance = 0.03;
+	settings.dotconf.dot_density = 30;
+	settings.dotconf.death_chance_maj = 5000;
+	settings.dotconf.looking_chance_mean = 150;
+	settings.dotconf.looking_chance_var = 80;
+	settings.dotconf.looking_chance_p = 5;
+	settings.dotconf.eat_time = 4;
+	settings.dotconf.generation_time = 6;
+	scenario.tune(settings.dotconf);
+	for (const string& assignment : assignments)
+		Configurator::assign(settings, assignment);
+	if (threads > 0) {
+		settings.dotconf.step_mode = StepMode::STEP_PARALLEL;
+		settings.dotconf.step_threads = threads;
+	}
+
+	unique_ptr<Simulator> p_sim;
+	Configurator::create(settings, p_sim);
+
+	for (unsigned int f = 0 ; f < warmup && p_sim->ndots() > 0 ; f++)
+		p_sim->step();
+	p_sim->resetProfile();
+
+	Result result = Result();
+	result.dots_start = p_sim->ndots();
+	const auto start = chrono::steady_clock::now();
+	while (result.frames < frames && p_sim->ndots() > 0) {
+		result.dot_steps += p_sim->ndots();
+		p_sim->step();
+		result.frames++;
+	}
+	result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	result.dots_end = p_sim->ndots();
+	if (result.dots_end > 0)
+		result.bytes_per_dot = (double)p_sim->getMemoryUsage() / result.dots_end;
+	result.profile = p_sim->getProfile();
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	result.peak_rss_kb = usage.ru_maxrss;
+	return result;
+}
+
+/** Run measure() in a child process. */
+static bool measureApart(const Scenario& scenario, const vector<string>& assignments,
+		unsigned int threads, unsigned int warmup, unsigned int frames, Result& result)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return false;
+
+	const pid_t pid = fork();
+	if (pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+	if (pid == 0) {
+		close(fds[0]);
+		const Result r = measure(scenario, assignments, threads, warmup, frames);
+		const bool ok = (write(fds[1], &r, sizeof(r)) == (ssize_t)sizeof(r));
+		_exit(ok ? 0 : 1);
+	}
+
+	close(fds[1]);
+	const bool ok = (read(fds[0], &result, sizeof(result)) == (ssize_t)sizeof(result));
+	close(fds[0]);
+	int status = 0;
+	waitpid(pid, &status, 0);
+	return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char** argv)
+{
+	vector<const Scenario*> scenarios;
+	vector<unsigned int> thread_counts;
+	vector<string> assignments;
+	unsigned int frames = 30;
+	unsigned int warmup = 3;
+	string output;
+
+	for (int i = 1 ; i < argc ; i++) {
+		const string arg = argv[i];
+		const bool has_value = (i + 1 < argc);
+		vector<string> items;
+
+		if (arg == "-s" && has_value && splitList(argv[++i], items)) {
+			for (const string& name : items) {
+				size_t s = 0;
+				while (s < N_SCENARIOS && name != SCENARIOS[s].name)
+					s++;
+				if (s == N_SCENARIOS) {
+					cerr << "Unknown scenario: " << name << endl;
+					return 2;
+				}
+				scenarios.push_back(&SCENARIOS[s]);
+			}
+		} else if (arg == "-t" && has_value && splitList(argv[++i], items)) {
+			for (const string& item : items)
+				thread_counts.push_back(strtoul(item.c_str(), nullptr, 10));
+		} else if (arg == "-n" && has_value)
+			frames = strtoul(argv[++i], nullptr, 10);
+		else if (arg == "-w" && has_value)
+			warmup = strtoul(argv[++i], nullptr, 10);
+		else if (arg == "-o" && has_value)
+			output = argv[++i];
+		else if (arg == "-h" || arg == "--help") {
+			usage(argv[0]);
+			return 0;
+		} else if (arg.find('=') != string::npos) {
+			Configurator::Settings check;
+			if (!Configurator::assign(check, arg)) {
+				cerr << "Bad setting: " << arg << endl;
+				return 2;
+			}
+			assignments.push_back(arg);
+		} else {
+			cerr << "Bad argument: " << arg << endl;
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (scenarios.empty()) {
+		for (size_t s = 0 ; s < N_SCENARIOS ; s++)
+			scenarios.push_back(&SCENARIOS[s]);
+	}
+	if (thread_counts.empty())
+		thread_counts.push_back(0);
+
+	ofstream file;
+	if (!output.empty()) {
+		file.open(output.c_str());
+		if (!file) {
+			cerr << "Cannot write " << output << endl;
+			return 1;
+		}
+	}
+	ostream& json = output.empty() ? cout : file;
+	json.precision(6);
+
+	json << "{" << endl
+		<< "  \"benchmark\": \"dots-bench\"," << endl
+		<< "  \"format\": 1," << endl
+		<< "  \"frames\": " << frames << "," << endl
+		<< "  \"warmup\": " << warmup << "," << endl
+		<< "  \"hardware_threads\": " << thread::hardware_concurrency() << "," << endl
+		<< "  \"isa\": " << jsonString(PairKernels::isaName(PairKernels::getIsa())) << "," << endl
+		<< "  \"overrides\": [";
+	for (size_t a = 0 ; a < assignments.size() ; a++)
+		json << (a > 0 ? ", " : "") << jsonString(assignments[a]);
+	json << "]," << endl
+		<< "  \"results\": [";
+
+	bool first = true;
+	int failures = 0;
+	for (const Scenario* scenario : scenarios) {
+		double base_rate = 0;
+		for (unsigned int threads : thread_counts) {
+			cerr << scenario->name << ", "
+				<< (threads > 0 ? to_string(threads) + " threads" : string("serial"))
+				<< "..." << flush;
+
+			Result r;
+			if (!measureApart(*scenario, assignments, threads, warmup, frames, r)) {
+				cerr << " failed" << endl;
+				failures++;
+				continue;
+			}
+			const double rate = (r.seconds > 0) ? r.frames / r.seconds : 0;
+			const double ns = (r.dot_steps > 0) ? r.seconds * 1e9 / r.dot_steps : 0;
+			if (base_rate == 0)
+				base_rate = rate;
+			cerr << ' ' << rate << " steps/s, " << ns << " ns per dot-step" << endl;
+
+			json << (first ? "" : ",") << endl
+				<< "    {" << endl
+				<< "      \"scenario\": " << jsonString(scenario->name) << "," << endl
+				<< "      \"grid_w\": " << scenario->grid_w << "," << endl
+				<< "      \"grid_h\": " << scenario->grid_h << "," << endl
+				<< "      \"init_dots\": " << scenario->init_dots << "," << endl
+				<< "      \"rand_seed\": " << scenario->rand_seed << "," << endl
+				<< "      \"threads\": " << threads << "," << endl
+				<< "      \"frames\": " << r.frames << "," << endl
+				<< "      \"dots_start\": " << r.dots_start << "," << endl
+				<< "      \"dots_end\": " << r.dots_end << "," << endl
+				<< "      \"dot_steps\": " << r.dot_steps << "," << endl
+				<< "      \"seconds\": " << r.seconds << "," << endl
+				<< "      \"steps_per_sec\": " << rate << "," << endl
+				<< "      \"ns_per_dot_step\": " << ns << "," << endl
+				<< "      \"scaling\": " << ((base_rate > 0) ? rate / base_rate : 0) << "," << endl
+				<< "      \"peak_rss_kb\": " << r.peak_rss_kb << "," << endl
+				<< "      \"bytes_per_dot\": " << r.bytes_per_dot;
+			if (r.profile.steps > 0) {
+				json << "," << endl << "      \"profile\": ";
+				r.profile.writeJson(json);
+			}
+			json << endl << "    }";
+			first = false;
+		}
+	}
+	json << endl << "  ]" << endl << "}" << endl;
+
+	return (failures > 0) ? 1 : 0;
+}
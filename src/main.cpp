@@ -38,23 +38,41 @@
 #include "Dot.h"
 #include "Configurator.h"
 #include "DotConf.h"
+#include "DotRenderer.h"
+#include "SimThread.h"
 #include "Simulator.h"
+#include "Trajectory.h"
 
 constexpr unsigned int DISPLAY_WIDTH = 512;
 constexpr unsigned int DISPLAY_HEIGHT = 512;
+/** Most redraws per second of a running simulation */
+constexpr unsigned int DISPLAY_RATE = 60;
 
 constexpr unsigned char KEYCODE_EXIT = 27;
 constexpr unsigned char KEYCODE_PAUSE = ' ';
 constexpr unsigned char KEYCODE_SPEEDUP = '+';
 constexpr unsigned char KEYCODE_SPEEDDOWN = '-';
+constexpr unsigned char KEYCODE_REVERSE = 'b';
+constexpr unsigned char KEYCODE_REWIND = 'r';
+constexpr unsigned char KEYCODE_FULLSPEED = 'f';
 
 using namespace std;
 
 // STATIC VARIABLES
 
 static unique_ptr<Simulator> p_sim = nullptr;
+// Steps p_sim once started; the display only reads its snapshots
+static unique_ptr<SimThread> p_thread = nullptr;
+static bool full_speed = false;
+static bool extinct = false;
 static int timebase;
 static int speed = 4;
+static DotRenderer renderer;
+
+// Playback of a recording, instead of a simulation
+static unique_ptr<Trajectory::Reader> p_replay = nullptr;
+static unsigned int replay_index = 0;
+static int replay_direction = 1;
 
 //static int pause_key = 0;
 
@@ -80,64 +98,20 @@ void setOrthographicProjection(int w, int h) {
 
 }
 
-void drawDot(const Dot& dot)
-{
-	float x = (float)dot.getX(), y = (float)dot.getY();
-	bool isAlpha = (dot.getType() == DotType::DOT_ALPHA);
-	glBegin(GL_QUADS);
-	//COLOR CHOICE
-		switch (dot.getStatus())
-		{
-		case STATUS_DEAD:
-			glColor3f(0.8f, 0.8f, 0.8f);	//White for dead
-			break;
-		case STATUS_LOOKING:
-			if (isAlpha)
-				glColor3f(1.0f, 0.2f, 0.4f);
-			else
-				glColor3f(0.4f, 0.2f, 1.0f);
-			break;
-		case STATUS_GENERATING:
-			glColor3f(1.0f, 0.2f, 1.0f);	//Magenta for generating
-			break;
-		case STATUS_HUNGRY:
-			if (isAlpha)
-				glColor3f(0.5f, 0.1f, 0.0f);
-			else
-				glColor3f(0.0f, 0.1f, 0.5f);
-			break;
-		case STATUS_EATING:
-			if (isAlpha)
-				glColor3f(0.8f, 0.4f, 0.1f);
-			else
-				glColor3f(0.1f, 0.4f, 0.8f);
-			break;
-		default:
-			if (isAlpha)
-				glColor3f(1.0f, 0.1f, 0.0f);
-			else
-				glColor3f(0.0f, 0.1f, 1.0f);
-			break;
-		}
-		glVertex2f(x,	y);
-		glVertex2f(x+1,	y);
-		glVertex2f(x+1,	y+1);
-		glVertex2f(x,	y+1);
-
-	glEnd();
-}
-
 void renderScene() {
 
 	glClearColor(0.0, 0.0, 0.0, 1.0);
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	//Iterate here to get all dots from the simulator
-
-    auto dots = p_sim->getDots();
-	for (auto it = begin(dots) ; it != end(dots) ; ++it) {
-		drawDot(it->second);
+	// every dot in a single draw
+	if (p_replay) {
+		const Trajectory::Frame* p_frame = p_replay->read(replay_index);
+		if (p_frame)
+			renderer.update(*p_frame);
 	}
+	else
+		renderer.update(p_thread->snapshot());
+	renderer.draw();
 
 	glFlush();
 }
@@ -155,32 +129,67 @@ void resize_win(int width, int height)
 
 void quit()
 {
+	if (p_thread)
+		p_thread->stop();
 	exit(0);
 }
 
+void replayKeys(unsigned char key)
+{
+	if (key == KEYCODE_REVERSE)
+	{
+		replay_direction = -replay_direction;
+		cout << "- Playing " << (replay_direction > 0 ? "forwards" : "backwards") << " -" << endl;
+	}
+
+	if (key == KEYCODE_REWIND)
+	{
+		replay_index = (replay_direction > 0) ? 0 : p_replay->size() - 1;
+		timebase = glutGet(GLUT_ELAPSED_TIME);
+		renderScene();
+	}
+}
+
 void checkKeys(unsigned char key, int x, int y)
 {
 	if (key == KEYCODE_EXIT)
 		quit();
 
-	if (key == KEYCODE_PAUSE)
+	if (key == KEYCODE_PAUSE && p_replay)
+	{
+		pause = !pause;
+		if (pause)
+			std::cout << "- PLAYBACK PAUSED at frame " << p_replay->frameNumber(replay_index) << " -" << std::endl;
+		else
+		{
+			std::cout << "- PLAYBACK RESUMED -" << std::endl;
+			timebase = glutGet(GLUT_ELAPSED_TIME);
+		}
+	}
+	else if (key == KEYCODE_PAUSE)
 	{
 		pause = !pause;
+		p_thread->setPaused(pause);
 		if (pause)
 		{
+			// the latest snapshot, the step under way may still show up
+			p_thread->update();
+			const SimThread::Snapshot& shot = p_thread->snapshot();
 			std::cout	<< "- SIMULATION PAUSED -" << std::endl
-				<< "Frame Nr: " << p_sim->getFrame() << std::endl
-				<< "Number of live Dots: " << p_sim->ndots() << std::endl
-				<< "Number of dead Dots so far: " << p_sim->getNDeaths() << std::endl
-				<< "Average Age of Death so far: " << p_sim->getDeathAverage() << std::endl
-				<< "Maximum Dot Age so far: " << p_sim->getMaxAge() << std::endl
-				<< "Maximum nr. of Live Dots so far:" << p_sim->getMaxDots() << std::endl;
+				<< "Frame Nr: " << shot.frame << std::endl
+				<< "Number of live Dots: " << shot.ndots << std::endl
+				<< "Number of dead Dots so far: " << shot.deaths << std::endl
+				<< "Average Age of Death so far: " << shot.death_average << std::endl
+				<< "Maximum Dot Age so far: " << shot.max_age << std::endl
+				<< "Maximum nr. of Live Dots so far:" << shot.max_dots << std::endl
+				<< "Alpha / Beta Dots: " << shot.census.ofType(DotType::DOT_ALPHA)
+				<< " / " << shot.census.ofType(DotType::DOT_BETA) << std::endl
+				<< "Hungry / Looking / Eating / Generating: "
+				<< shot.census.ofStatus(STATUS_HUNGRY) << " / " << shot.census.ofStatus(STATUS_LOOKING) << " / "
+				<< shot.census.ofStatus(STATUS_EATING) << " / " << shot.census.ofStatus(STATUS_GENERATING) << std::endl;
 		}
 		else
-		{
 			std::cout << "- SIMULATION RESUMED -" << std::endl;
-			timebase = glutGet(GLUT_ELAPSED_TIME);
-		}
 	}
 
 	if (key == KEYCODE_SPEEDUP)
@@ -190,7 +199,8 @@ void checkKeys(unsigned char key, int x, int y)
 		else
 			speed++;
 
-		cout << "- Simulation speed increased to " << speed << " steps per second. " << std::endl;
+		cout << "- Simulation speed increased to " << speed
+			<< (p_replay ? " frames" : " steps") << " per second. " << std::endl;
 	}
 
 	if (key == KEYCODE_SPEEDDOWN)
@@ -199,32 +209,75 @@ void checkKeys(unsigned char key, int x, int y)
 		if (speed > s)
 		{
 			speed -= s;
-			cout << "- Simulation speed decreased to " << speed << " steps per second. " << std::endl;
+			cout << "- Simulation speed decreased to " << speed
+				<< (p_replay ? " frames" : " steps") << " per second. " << std::endl;
 		}
 	}
+
+	if (key == KEYCODE_FULLSPEED && !p_replay)
+	{
+		full_speed = !full_speed;
+		if (full_speed)
+			cout << "- Simulation at full speed -" << endl;
+		else
+			cout << "- Simulation back to " << speed << " steps per second -" << endl;
+	}
+
+	if (p_replay)
+		replayKeys(key);
+	else if (!full_speed)
+		p_thread->setSpeed(speed);
+	else
+		p_thread->setSpeed(0);
+}
+
+void replayLoop(void)
+{
+	int time = glutGet(GLUT_ELAPSED_TIME);
+
+	// as many recorded frames as the speed asks for, however few get drawn
+	const long long frames = (long long)(time - timebase) * speed / 1000;
+	if (frames <= 0)
+		return;
+	timebase = time;
+
+	const long long last = p_replay->size() - 1;
+	const long long next = min(max(replay_index + replay_direction * frames, 0LL), last);
+	if (next == replay_index)
+		return;
+	replay_index = (unsigned int)next;
+	if (!p_replay->read(replay_index))
+		cerr << "Cannot decode frame " << p_replay->frameNumber(replay_index) << endl;
+	if (replay_index == 0 || next == last)
+		cout << "- End of the recording, at frame " << p_replay->frameNumber(replay_index)
+			<< ". Press " << KEYCODE_REVERSE << " to reverse or " << KEYCODE_REWIND << " to rewind. -" << endl;
+	renderScene();
 }
 
 void idleLoop(void)
 {
 	if (!pause)
-	{
-		int time = glutGet(GLUT_ELAPSED_TIME);
-
-		if (time - timebase > 1000.0 / speed) {
-			p_sim->step();
-            if (p_sim->ndots() == 0) {
-            cout    << " All dots are dead! " << endl
-					<< "Frame Nr: " << p_sim->getFrame() << endl
-					<< "Number of dead Dots: " << p_sim->getNDeaths() << endl
-					<< "Average Age of Death: " << p_sim->getDeathAverage() << endl
-					<< "Maximum Dot Age:" << p_sim->getMaxAge() << endl
-					<< "Maximum nr. of Live Dots:" << p_sim->getMaxDots() << endl
-					<< " Press Esc to leave." << endl;
-            }
-			timebase = time;
-			renderScene();
-		}
+		replayLoop();
+}
+
+void refreshLoop(int)
+{
+	glutTimerFunc(1000 / DISPLAY_RATE, refreshLoop, 0);
+	if (!p_thread->update())
+		return;
+
+	const SimThread::Snapshot& shot = p_thread->snapshot();
+	if (shot.ndots == 0 && !extinct) {
+		extinct = true;
+		cout    << " All dots are dead! " << endl
+				<< "Frame Nr: " << shot.frame << endl
+				<< "Number of dead Dots: " << shot.deaths << endl
+				<< "Average Age of Death: " << shot.death_average << endl
+				<< "Maximum Dot Age:" << shot.max_age << endl
+				<< "Maximum nr. of Live Dots:" << shot.max_dots << endl
+				<< " Press Esc to leave." << endl;
 	}
+	renderScene();
 }
 
 int main(int argc, char** argv)
@@ -240,15 +293,35 @@ int main(int argc, char** argv)
 	glutInitDisplayMode(GLUT_SINGLE | GLUT_RGBA);
 
 	glutCreateWindow("Dots Simulator");
+	renderer.init();
 
 	glutDisplayFunc(renderScene);
-	glutIdleFunc(idleLoop);
 	glutReshapeFunc(resize_win);
 	glutKeyboardFunc(checkKeys);
 	glutSetKeyRepeat(GLUT_KEY_REPEAT_OFF);
 
 	timebase = glutGet(GLUT_ELAPSED_TIME);
 
+	// dots --play FILE shows a recording instead of simulating
+	if (argc == 3 && string(argv[1]) == "--play")
+	{
+		p_replay.reset(new Trajectory::Reader());
+		if (!p_replay->open(argv[2], std::cerr) || p_replay->size() == 0)
+		{
+			std::cerr << "Program failed: Cannot play " << argv[2] << std::endl;
+			return -1;
+		}
+		speed = 30;
+		std::cout << "Playing " << p_replay->size() << " recorded frames, from frame "
+			<< p_replay->frameNumber(0) << " to " << p_replay->frameNumber(p_replay->size() - 1) << std::endl
+			<< "+/- change the speed, " << KEYCODE_REVERSE << " reverses, " << KEYCODE_REWIND << " rewinds" << std::endl;
+		setOrthographicProjection(p_replay->getWidth(), p_replay->getHeight());
+		glViewport(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+		glutIdleFunc(idleLoop);
+		glutMainLoop();
+		quit();
+	}
+
 	//Configure DotConf & Simulator
 	bool configure_ok = Configurator::configure(p_sim);
 	if (!configure_ok)
@@ -259,6 +332,12 @@ int main(int argc, char** argv)
 
 	setOrthographicProjection(p_sim->getWidth(), p_sim->getHeight());
 
+	// the simulation steps on its own thread from now on
+	p_thread.reset(new SimThread(*p_sim, speed));
+	p_thread->start();
+	p_thread->update();
+	glutTimerFunc(1000 / DISPLAY_RATE, refreshLoop, 0);
+
 	// Set the viewport to be the entire window
     glViewport(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
 
@@ -0,0 +1,306 @@
+/** \file sweep.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <memory>
+#include "Configurator.h"
+#include "Simulator.h"
+#include "ThreadPool.h"
+
+/* Parameter sweeps: every combination of the swept values, with every
+ * seed, each run by a simulator of its own. Simulators share nothing, so
+ * the runs are spread over a thread pool within one process, each thread
+ * taking the next run as soon as it is done with one. The final
+ * statistics of every run are gathered into one CSV table. */
+
+using namespace std;
+
+/** A setting and the values it takes in the sweep. */
+struct Sweep
+{
+	string name;
+	vector<string> values;
+};
+
+/** Final statistics of a run. */
+struct Result
+{
+	unsigned int seed;
+	unsigned int frames;
+	unsigned int ndots;
+	double deaths;
+	double death_average;
+	unsigned int max_age;
+	unsigned int max_dots;
+	double seconds;
+	/** Memory held for the dots, over the dots left */
+	double bytes_per_dot;
+	/** Dots by status at the end, the same census for any engine */
+	unsigned int by_status[DotStore::N_STATUSES];
+};
+
+/** Census columns, in DotStatus order */
+static const char* const STATUS_COLUMNS[DotStore::N_STATUSES] = {
+	"normal", "dead", "hungry", "looking", "eating", "generating"
+};
+
+static void usage(const char* program)
+{
+	cerr << "Usage: " << program << " [options] name=value[,value...] ..." << endl
+		<< "  -c FILE    config file (default " << CONFIG_FILENAME << ")" << endl
+		<< "  -n FRAMES  frames per run (default 1000)" << endl
+		<< "  -s LIST    comma separated seeds or ranges of seeds, such as 1-100"
+		<< " (default the config file's)" << endl
+		<< "  -j THREADS runs side by side, 0 for one per hardware thread (default 0)" << endl
+		<< "  -o FILE    write the results there instead of the standard output" << endl
+		<< "  -q         do not report progress" << endl
+		<< "  name=value override a setting (see Configurator::assign); with a list"
+		<< " of values, every one of them is swept" << endl
+		<< "Runs step their dots serially, stop early when every dot is dead, and"
+		<< " give a line each: run, seed, swept settings and final statistics." << endl;
+}
+
+static bool parseCount(const char* text, unsigned long& value)
+{
+	char* end;
+	value = strtoul(text, &end, 10);
+	return *text != '\0' && *end == '\0';
+}
+
+static bool splitList(const string& text, vector<string>& items)
+{
+	items.clear();
+	stringstream input(text);
+	string item;
+	while (getline(input, item, ','))
+		items.push_back(item);
+	return !items.empty();
+}
+
+static bool parseSeeds(const string& text, vector<unsigned int>& seeds)
+{
+	vector<string> items;
+	if (!splitList(text, items))
+		return false;
+	for (const string& item : items) {
+		const size_t dash = item.find('-', 1);
+		unsigned long first, last;
+		if (dash == string::npos) {
+			if (!parseCount(item.c_str(), first))
+				return false;
+			last = first;
+		} else if (!parseCount(item.substr(0, dash).c_str(), first)
+				|| !parseCount(item.substr(dash + 1).c_str(), last) || last < first)
+			return false;
+		for (unsigned long s = first ; s <= last ; s++)
+			seeds.push_back(s);
+	}
+	return true;
+}
+
+static Result simulate(const Configurator::Settings& settings, unsigned long frames)
+{
+	const auto start = chrono::steady_clock::now();
+	unique_ptr<Simulator> p_sim;
+	Configurator::create(settings, p_sim);
+	while (p_sim->getFrame() < frames && p_sim->ndots() > 0)
+		p_sim->step();
+
+	Result result;
+	result.seed = settings.rand_seed;
+	result.frames = p_sim->getFrame();
+	result.ndots = p_sim->ndots();
+	result.deaths = p_sim->getNDeaths();
+	result.death_average = p_sim->getDeathAverage();
+	result.max_age = p_sim->getMaxAge();
+	result.max_dots = p_sim->getMaxDots();
+	result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	result.bytes_per_dot = (result.ndots > 0)
+			? (double)p_sim->getMemoryUsage() / result.ndots : 0;
+	const DotStore::Census census = p_sim->getCensus();
+	for (unsigned int s = 0 ; s < DotStore::N_STATUSES ; s++)
+		result.by_status[s] = census.ofStatus(static_cast<DotStatus>(s));
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	string config = CONFIG_FILENAME;
+	unsigned long frames = 1000;
+	unsigned long threads = 0;
+	vector<unsigned int> seeds;
+	string output;
+	bool quiet = false;
+	vector<Sweep> sweeps;
+
+	for (int i = 1 ; i < argc ; i++) {
+		const string arg = argv[i];
+		if ((arg == "-c" || arg == "-n" || arg == "-s" || arg == "-j" || arg == "-o")
+				&& i + 1 >= argc) {
+			cerr << "Missing value after " << arg << endl;
+			return 2;
+		}
+
+		if (arg == "-c")
+			config = argv[++i];
+		else if (arg == "-n" && parseCount(argv[i + 1], frames) && frames > 0)
+			i++;
+		else if (arg == "-s" && parseSeeds(argv[i + 1], seeds))
+			i++;
+		else if (arg == "-j" && parseCount(argv[i + 1], threads))
+			i++;
+		else if (arg == "-o")
+			output = argv[++i];
+		else if (arg == "-q")
+			quiet = true;
+		else if (arg == "-h" || arg == "--help") {
+			usage(argv[0]);
+			return 0;
+		} else if (arg.find('=') != string::npos) {
+			// every value must make a valid setting
+			Sweep sweep;
+			sweep.name = arg.substr(0, arg.find('='));
+			Configurator::Settings check;
+			if (!splitList(arg.substr(arg.find('=') + 1), sweep.values)) {
+				cerr << "Bad setting: " << arg << endl;
+				return 2;
+			}
+			for (const string& value : sweep.values) {
+				if (!Configurator::assign(check, sweep.name + "=" + value)) {
+					cerr << "Bad setting: " << sweep.name << "=" << value << endl;
+					return 2;
+				}
+			}
+			sweeps.push_back(sweep);
+		} else {
+			cerr << "Bad argument: " << arg << endl;
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	Configurator::Settings base;
+	ostream nowhere(nullptr);
+	if (!Configurator::read(config, base, nowhere)) {
+		cerr << "Program failed: Cannot read " << config << endl;
+		return 1;
+	}
+	if (seeds.empty())
+		seeds.push_back(base.rand_seed);
+
+	// runs go seed by seed, over every combination of swept values
+	unsigned long nruns = seeds.size();
+	for (const Sweep& sweep : sweeps)
+		nruns *= sweep.values.size();
+	if (nruns > ~0u) {
+		cerr << "Too many runs: " << nruns << endl;
+		return 2;
+	}
+	auto settingsOf = [&](unsigned int run) {
+		Configurator::Settings settings = base;
+		unsigned int rest = run;
+		for (auto sweep = sweeps.rbegin() ; sweep != sweeps.rend() ; ++sweep) {
+			Configurator::assign(settings, sweep->name + "=" + sweep->values[rest % sweep->values.size()]);
+			rest /= sweep->values.size();
+		}
+		settings.rand_seed = seeds[rest];
+		// the pool runs simulations side by side, each one steps alone
+		settings.dotconf.step_mode = StepMode::STEP_SERIAL;
+		return settings;
+	};
+
+	ofstream file;
+	if (!output.empty()) {
+		file.open(output);
+		if (!file) {
+			cerr << "Cannot write " << output << endl;
+			return 1;
+		}
+	}
+	ostream& table = output.empty() ? cout : file;
+
+	ThreadPool pool(threads);
+	if (!quiet)
+		cerr << nruns << " runs of " << frames << " frames on " << pool.size() << " threads" << endl;
+
+	vector<Result> results(nruns);
+	mutex progress_lock;
+	unsigned int finished = 0;
+	const auto start = chrono::steady_clock::now();
+	pool.run(0, nruns, [&](unsigned int first, unsigned int last) {
+		for (unsigned int run = first ; run < last ; run++) {
+			results[run] = simulate(settingsOf(run), frames);
+			if (!quiet) {
+				lock_guard<mutex> lock(progress_lock);
+				cerr << "run " << run << " done (" << ++finished << "/" << nruns << ")" << endl;
+			}
+		}
+	}, 1);
+	if (!quiet)
+		cerr << "All runs done in "
+			<< chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+
+	table << "run,seed";
+	for (const Sweep& sweep : sweeps)
+		table << ',' << sweep.name;
+	table << ",frame,ndots,deaths,death_average,max_age,max_dots,seconds,bytes_per_dot";
+	for (const char* column : STATUS_COLUMNS)
+		table << ',' << column;
+	table << endl;
+	for (unsigned int run = 0 ; run < nruns ; run++) {
+		const Result& r = results[run];
+		table << run << ',' << r.seed;
+		unsigned int rest = run;
+		vector<string> values(sweeps.size());
+		for (size_t k = sweeps.size() ; k-- > 0 ; ) {
+			values[k] = sweeps[k].values[rest % sweeps[k].values.size()];
+			rest /= sweeps[k].values.size();
+		}
+		for (const string& value : values)
+			table << ',' << value;
+		table << ',' << r.frames << ',' << r.ndots << ',' << r.deaths << ',';
+		if (r.deaths > 0)
+			table << r.death_average;
+		else
+			table << "nan";
+		table << ',' << r.max_age << ',' << r.max_dots << ',' << r.seconds << ',';
+		if (r.ndots > 0)
+			table << r.bytes_per_dot;
+		else
+			table << "nan";
+		for (unsigned int n : r.by_status)
+			table << ',' << n;
+		table << endl;
+	}
+
+	return table ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+/** \file checkpoint_test.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Resumes from checkpoints cut short at every length, each of which must
+ * be reported as damaged, never read past its end. The whole checkpoint
+ * must still resume, to the same dots. Checkpoints with any one byte
+ * overwritten must either be reported as damaged or resume to dots whose
+ * every attribute is in its range. A scheduled event whose end flag is
+ * neither 0 nor 1 must not be taken back. */
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "DotSchedule.h"
+#include "Simulator.h"
+
+using namespace std;
+
+static const char* const SAVED = "checkpoint_test.tmp";
+static const char* const CUT = "checkpoint_test.cut";
+
+static bool writeFile(const string& filename, const vector<char>& bytes, size_t size)
+{
+	ofstream out(filename.c_str(), ios::binary | ios::trunc);
+	out.write(bytes.data(), size);
+	return out.good();
+}
+
+/** \return whether every dot of a world lies in it, with a valid status
+ * and type, and a partner other than itself */
+static bool inRange(const Simulator& sim)
+{
+	for (const DotStore::DotRef& dot : sim.view()) {
+		const unsigned char type = static_cast<unsigned char>(dot.type());
+		if (dot.x() < 0 || dot.x() >= sim.getWidth() || dot.y() < 0 || dot.y() >= sim.getHeight()
+				|| dot.status() < STATUS_NORMAL || dot.status() > STATUS_GENERATING
+				|| type > 1 || dot.partner() == dot.id() || dot.age() > sim.getFrame())
+			return false;
+	}
+	return true;
+}
+
+/** Save a short run with the given engines, resume from every cut, then
+ * from every one-byte corruption.
+ * \return the number of failures
+ */
+static unsigned int checkCuts(const char* name, const DotConf& base)
+{
+	DotConf conf(base);
+	conf.updateLookProb();
+	Simulator sim(4321, conf, 32, 32);
+	for (int i = 0 ; i < 60 ; i++)
+		sim.addRDot();
+	for (int i = 0 ; i < 40 ; i++)
+		sim.step();
+	if (!sim.save(SAVED, cerr)) {
+		cerr << name << ": cannot save a checkpoint" << endl;
+		return 1;
+	}
+
+	ifstream in(SAVED, ios::binary);
+	const vector<char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+	unsigned int failures = 0;
+	for (size_t size = 0 ; size < bytes.size() ; size++) {
+		if (!writeFile(CUT, bytes, size)) {
+			cerr << name << ": cannot write " << CUT << endl;
+			return failures + 1;
+		}
+		ostringstream log;
+		unique_ptr<Simulator> p_sim;
+		if (Simulator::restore(CUT, p_sim, log)) {
+			cerr << name << ": resumed from the first " << size << " of "
+					<< bytes.size() << " bytes" << endl;
+			failures++;
+		}
+	}
+
+	for (size_t pos = 0 ; pos < bytes.size() ; pos++) {
+		vector<char> damaged(bytes);
+		damaged[pos] = static_cast<char>(0xff);
+		if (!writeFile(CUT, damaged, damaged.size())) {
+			cerr << name << ": cannot write " << CUT << endl;
+			return failures + 1;
+		}
+		ostringstream log;
+		unique_ptr<Simulator> p_sim;
+		if (Simulator::restore(CUT, p_sim, log) && !inRange(*p_sim)) {
+			cerr << name << ": resumed to dots out of range with byte " << pos
+					<< " overwritten" << endl;
+			failures++;
+		}
+	}
+
+	unique_ptr<Simulator> p_sim;
+	if (!Simulator::restore(SAVED, p_sim, cerr)) {
+		cerr << name << ": cannot resume from the whole checkpoint" << endl;
+		failures++;
+	} else if (p_sim->getFrame() != sim.getFrame() || p_sim->ndots() != sim.ndots()) {
+		cerr << name << ": resumed to other dots" << endl;
+		failures++;
+	}
+	return failures;
+}
+
+/** Save a queue of one event, set its end flag to a byte a bool cannot
+ * hold, and take the queue back.
+ * \return the number of failures
+ */
+static unsigned int checkEventEnd(void)
+{
+	DotSchedule::Event event;
+	// zero the padding too, so the event can be found byte for byte
+	memset(&event, 0, sizeof(event));
+	event.id = 0x5eed5eed;
+	event.frame = 77;
+	event.count = 3;
+	event.status = STATUS_EATING;
+	event.end = true;
+	DotSchedule schedule;
+	schedule.add(event);
+
+	Checkpoint::Writer out;
+	schedule.save(out);
+	if (!out.write(SAVED, cerr)) {
+		cerr << "event end: cannot save a checkpoint" << endl;
+		return 1;
+	}
+	ifstream in(SAVED, ios::binary);
+	vector<char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	const char* first = reinterpret_cast<const char*>(&event);
+	const vector<char>::iterator found = search(bytes.begin(), bytes.end(), first, first + sizeof(event));
+	if (found == bytes.end()) {
+		cerr << "event end: the event is not in the checkpoint" << endl;
+		return 1;
+	}
+	found[offsetof(DotSchedule::Event, end)] = 2;
+	if (!writeFile(CUT, bytes, bytes.size())) {
+		cerr << "event end: cannot write " << CUT << endl;
+		return 1;
+	}
+
+	Checkpoint::Reader reader;
+	DotSchedule restored;
+	if (reader.open(CUT, cerr) && restored.restore(reader)) {
+		cerr << "event end: took back an end flag of 2" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+int main(void)
+{
+	// short lifetimes keep the tables, and every restore, small
+	DotConf conf;
+	conf.death_chance_maj = 300;
+	unsigned int failures = checkCuts("direct", conf);
+
+	conf.density_mode = DensityMode::DENSITY_INCREMENTAL;
+	failures += checkCuts("incremental", conf);
+
+	conf.density_mode = DensityMode::DENSITY_DIRECT;
+	conf.schedule_mode = ScheduleMode::SCHEDULE_EVENTS;
+	failures += checkCuts("events", conf);
+
+	conf.schedule_mode = ScheduleMode::SCHEDULE_LIFETIMES;
+	failures += checkCuts("lifetimes", conf);
+
+	failures += checkEventEnd();
+
+	remove(SAVED);
+	remove(CUT);
+	cout << failures << " failures" << endl;
+	return (failures == 0) ? 0 : 1;
+}
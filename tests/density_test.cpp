@@ -0,0 +1,99 @@
+/** \file density_test.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Runs the incremental density field for thousands of frames, with and
+ * without periodic rebuilds, and checks it every so often against the
+ * field computed from scratch. The largest relative error must stay
+ * below TOLERANCE all along. */
+#include <algorithm>
+#include <iostream>
+#include "Simulator.h"
+
+using namespace std;
+
+/** Largest relative error allowed: round-off builds up over the
+ * applied deltas, but stays orders of magnitude below this */
+static const double TOLERANCE = 1e-9;
+static const unsigned int FRAMES = 4000;
+/** Frames between checks, each of which convolves the whole field */
+static const unsigned int CHECK_PERIOD = 100;
+
+/** Run a world from a seed, checking its density field as it goes.
+ * \param period DotConf::density_rebuild_period
+ * \return the number of failures
+ */
+static unsigned int checkDrift(unsigned int seed, int period)
+{
+	DotConf conf;
+	conf.density_mode = DensityMode::DENSITY_INCREMENTAL;
+	conf.density_rebuild_period = period;
+	// the sample config.txt, crowding out dots early enough that the
+	// field mostly changes by a few moves per step, applied as deltas
+	conf.hunger_chance = 0.03;
+	conf.dot_density = 300;
+	conf.death_chance_maj = 5000;
+	conf.looking_chance_mean = 150;
+	conf.looking_chance_var = 80;
+	conf.looking_chance_p = 5;
+	conf.eat_time = 4;
+	conf.generation_time = 6;
+	conf.updateLookProb();
+	Simulator sim(seed, conf, 64, 64);
+	for (int i = 0 ; i < 30 ; i++)
+		sim.addRDot();
+
+	double worst = 0;
+	unsigned int failures = 0;
+	while (sim.getFrame() < FRAMES && sim.ndots() > 0) {
+		sim.step();
+		if (sim.getFrame() % CHECK_PERIOD != 0)
+			continue;
+		const double error = sim.getDensityError();
+		worst = max(worst, error);
+		if (!(error <= TOLERANCE)) {
+			cerr << "seed " << seed << ", period " << period << ": error " << error
+					<< " at frame " << sim.getFrame() << endl;
+			failures++;
+		}
+	}
+	if (sim.getFrame() < FRAMES) {
+		// an extinct world would leave the field untested
+		cerr << "seed " << seed << ": every dot died at frame " << sim.getFrame() << endl;
+		failures++;
+	}
+	cout << "seed " << seed << ", period " << period << ": " << sim.ndots()
+			<< " dots, largest error " << worst << endl;
+	return failures;
+}
+
+int main(void)
+{
+	unsigned int failures = 0;
+	for (unsigned int seed = 1 ; seed <= 3 ; seed++) {
+		failures += checkDrift(seed, 0);
+		failures += checkDrift(seed, 100);
+	}
+	cout << failures << " failures" << endl;
+	return (failures == 0) ? 0 : 1;
+}
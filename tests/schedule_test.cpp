@@ -0,0 +1,149 @@
+/** \file schedule_test.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Runs the same worlds from many seeds with every schedule mode, and
+ * checks that the event and lifetime schedules are statistically
+ * equivalent to stepping every dot: for each status, the share of
+ * dot-frames spent in it over a run, and the deaths of each run, must
+ * follow the same distribution over the seeds as with SCHEDULE_STEPS.
+ * Runs are independent, so two-sample Kolmogorov-Smirnov tests compare
+ * them; a mode fails when any statistic's D is above the critical value
+ * for ALPHA. */
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "Simulator.h"
+
+using namespace std;
+
+static const unsigned int SEEDS = 100;
+static const unsigned int FRAMES = 500;
+/** Chance of a false failure for each statistic; with 7 statistics and
+ * 2 modes, the whole test fails less than once in 70 runs of random seeds */
+static const double ALPHA = 0.001;
+/** Statistics of a run: share of each status, then the deaths */
+static const unsigned int N_STATS = DotStore::N_STATUSES + 1;
+static const char* const STAT_NAMES[N_STATS] = {
+	"normal", "dead", "hungry", "looking", "eating", "generating", "deaths"
+};
+
+/** Run a world from a seed.
+ * \return its statistics, see N_STATS */
+static vector<double> run(ScheduleMode mode, unsigned int seed)
+{
+	DotConf conf;
+	conf.schedule_mode = mode;
+	// the sample config.txt with shorter lives, so that deaths of old age
+	// are common while the population lasts
+	conf.hunger_chance = 0.03;
+	conf.dot_density = 30;
+	conf.death_chance_maj = 1000;
+	conf.looking_chance_mean = 100;
+	conf.looking_chance_var = 50;
+	conf.looking_chance_p = 5;
+	conf.eat_time = 4;
+	conf.generation_time = 6;
+	conf.updateLookProb();
+	Simulator sim(seed, conf, 32, 32);
+	for (int i = 0 ; i < 100 ; i++)
+		sim.addRDot();
+
+	vector<double> stats(N_STATS, 0.0);
+	double dot_frames = 0;
+	for (unsigned int f = 0 ; f < FRAMES && sim.ndots() > 0 ; f++) {
+		sim.step();
+		const DotStore::Census census = sim.getCensus();
+		for (unsigned int s = 0 ; s < DotStore::N_STATUSES ; s++)
+			stats[s] += census.ofStatus(static_cast<DotStatus>(s));
+		dot_frames += census.total();
+	}
+	for (unsigned int s = 0 ; s < DotStore::N_STATUSES ; s++)
+		stats[s] = (dot_frames > 0) ? stats[s] / dot_frames : 0;
+	stats[DotStore::N_STATUSES] = sim.getNDeaths();
+	return stats;
+}
+
+/** \return the two-sample Kolmogorov-Smirnov statistic: the largest
+ * distance between the empirical distributions of two samples */
+static double ksDistance(vector<double> a, vector<double> b)
+{
+	sort(begin(a), end(a));
+	sort(begin(b), end(b));
+	size_t i = 0, j = 0;
+	double d = 0;
+	while (i < a.size() && j < b.size()) {
+		// step past every copy of the lower value in both samples
+		const double v = min(a[i], b[j]);
+		while (i < a.size() && a[i] == v)
+			i++;
+		while (j < b.size() && b[j] == v)
+			j++;
+		d = max(d, fabs((double)i / a.size() - (double)j / b.size()));
+	}
+	return d;
+}
+
+/** \return the smallest D at which samples of sizes n and m differ at
+ * level ALPHA, by the asymptotic distribution of the statistic */
+static double ksCritical(size_t n, size_t m)
+{
+	return sqrt(-0.5 * log(ALPHA / 2) * (double)(n + m) / ((double)n * m));
+}
+
+int main(void)
+{
+	const ScheduleMode modes[] = {
+		ScheduleMode::SCHEDULE_STEPS, ScheduleMode::SCHEDULE_EVENTS,
+		ScheduleMode::SCHEDULE_LIFETIMES
+	};
+	const char* const names[] = { "steps", "events", "lifetimes" };
+
+	// samples[mode][stat][seed]
+	vector<vector<vector<double>>> samples(3, vector<vector<double>>(N_STATS));
+	for (unsigned int m = 0 ; m < 3 ; m++) {
+		for (unsigned int seed = 1 ; seed <= SEEDS ; seed++) {
+			const vector<double> stats = run(modes[m], seed);
+			for (unsigned int s = 0 ; s < N_STATS ; s++)
+				samples[m][s].push_back(stats[s]);
+		}
+	}
+
+	const double critical = ksCritical(SEEDS, SEEDS);
+	unsigned int failures = 0;
+	for (unsigned int m = 1 ; m < 3 ; m++) {
+		for (unsigned int s = 0 ; s < N_STATS ; s++) {
+			const double d = ksDistance(samples[0][s], samples[m][s]);
+			cout << names[m] << " vs " << names[0] << ", " << STAT_NAMES[s]
+					<< ": D = " << d << endl;
+			if (d > critical) {
+				cerr << names[m] << " differs from " << names[0] << " in "
+						<< STAT_NAMES[s] << ": D = " << d << " > " << critical << endl;
+				failures++;
+			}
+		}
+	}
+	cout << failures << " failures (critical D = " << critical << ")" << endl;
+	return (failures == 0) ? 0 : 1;
+}
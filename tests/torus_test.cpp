@@ -0,0 +1,83 @@
+/** \file torus_test.cpp
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Steps dots in the largest world the dot store allows, where the
+ * squared distance between points half a world apart on both axes is
+ * 2^31. Every nearest dot query is checked against a full scan, and the
+ * tree's density against the exact sum, so that a squared distance
+ * overflowing on the way shows up as a mismatch. */
+#include <cmath>
+#include <iostream>
+#include "Simulator.h"
+
+using namespace std;
+
+static const int SIZE = DotStore::MAX_GRID;
+static const unsigned int FRAMES = 20;
+/** Largest relative error allowed of the density tree */
+static const double TOLERANCE = 1e-9;
+
+/** Step an alpha dot in a corner with a beta dot half a world away on
+ * both axes, another at the opposite corner, and a third nearby.
+ * \return the number of failures
+ */
+static unsigned int checkCorners(const char* name, DensityMode mode)
+{
+	DotConf conf;
+	conf.density_mode = mode;
+	// an exact tree walk, whatever the distances
+	conf.density_theta = 0;
+	conf.nearest_check = true;
+	conf.updateLookProb();
+	Simulator sim(1234, conf, SIZE, SIZE);
+	// the far beta dot comes last, so a scan finds the near one first
+	sim.addDot(0, 0, DotType::DOT_ALPHA);
+	sim.addDot(SIZE - 1, SIZE - 1, DotType::DOT_BETA);
+	sim.addDot(SIZE / 2, SIZE / 2, DotType::DOT_BETA);
+	sim.addDot(SIZE / 2, SIZE / 2 - 1000, DotType::DOT_ALPHA);
+
+	unsigned int failures = 0;
+	for (unsigned int f = 0 ; f < FRAMES && sim.ndots() > 0 ; f++) {
+		sim.step();
+		const double error = sim.getDensityError();
+		if (!(error <= TOLERANCE)) {
+			cerr << name << ": density error " << error << " at frame " << sim.getFrame() << endl;
+			failures++;
+		}
+	}
+	if (sim.getNearestMismatches() > 0) {
+		cerr << name << ": " << sim.getNearestMismatches()
+				<< " nearest dot queries differ from a full scan" << endl;
+		failures++;
+	}
+	return failures;
+}
+
+int main(void)
+{
+	unsigned int failures = checkCorners("direct", DensityMode::DENSITY_DIRECT);
+	failures += checkCorners("tree", DensityMode::DENSITY_TREE);
+	cout << failures << " failures" << endl;
+	return (failures == 0) ? 0 : 1;
+}